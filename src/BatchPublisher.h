@@ -0,0 +1,310 @@
+// BatchPublisher.h
+#ifndef BATCH_PUBLISHER_H
+#define BATCH_PUBLISHER_H
+
+#include <stdarg.h>
+#include <stdio.h>
+#include "FrameParser.h"
+#include "FlashQueue.h"
+#include "PublishTransport.h"
+
+#ifndef BATCH_MAX_STATIONS
+#define BATCH_MAX_STATIONS 8
+#endif
+
+// Worst-case JSON size of one station with all 9 channels, and of the document
+// around the stations (see encodeBatch)
+#define BATCH_STATION_MAX_BYTES 600
+#define BATCH_DOCUMENT_BYTES 48
+
+// Sized so a full batch of BATCH_MAX_STATIONS always goes out as one message
+#ifndef BATCH_MAX_PAYLOAD
+#define BATCH_MAX_PAYLOAD (BATCH_DOCUMENT_BYTES + BATCH_MAX_STATIONS * BATCH_STATION_MAX_BYTES)
+#endif
+
+// Coalesces readings from several stations over a time window into one JSON batch
+// and delivers it through a PublishTransport. With a FlashQueue, every batch is
+// written to it first and sent from there at a bounded rate, oldest first; a batch
+// leaves the queue only once the transport reports it DELIVERED (for MQTT: the
+// PUBACK arrived), so neither an outage nor a half-open link loses it. Without a
+// queue, batches are sent once and lost if the link is down.
+//
+// All methods take the current time so the publisher can run on a virtual clock.
+// Call add() and loop() from the same task.
+class BatchPublisher {
+public:
+    struct Config {
+        unsigned long windowMs;           // How long readings are coalesced
+        unsigned long reconnectMs;        // Delay between connection attempts
+        uint16_t drainPerSecond;          // Max queued messages sent per second
+        unsigned long statsIntervalMs;    // Interval messagesPerSecond is measured over
+        Config() : windowMs(10000), reconnectMs(5000), drainPerSecond(5), statsIntervalMs(10000) {}
+    };
+
+    struct Stats {
+        uint32_t batches;            // Batches built
+        uint32_t readingsBatched;    // Channels with valid data over all batches
+        uint32_t messagesSent;       // Messages delivered by the transport
+        uint32_t messagesQueued;     // Messages written to the flash queue
+        uint32_t messagesRetried;    // Sends that failed before the transport confirmed them
+        uint32_t queueDropped;       // Messages lost because the queue was full
+        uint16_t queueDepth;         // Messages currently queued
+        uint16_t lastBatchStations;  // Stations in the last batch
+        uint16_t lastBatchReadings;  // Channels with valid data in the last batch
+        uint16_t lastBatchBytes;     // Payload size of the last batch
+        float messagesPerSecond;     // Send rate over the last stats interval
+    };
+
+private:
+    struct Station {
+        uint16_t deviceId;
+        int rssi;
+        uint32_t receivedAt;      // Unix seconds, 0 if the receiver's clock was not set
+        KlimaLoggFrameParser::CurrentData data;
+    };
+
+    PublishTransport& transport;
+    FlashQueue* queue;
+    Config config;
+    Stats stats;
+
+    Station stations[BATCH_MAX_STATIONS];
+    uint8_t stationCount;
+    unsigned long windowStart;
+
+    unsigned long lastConnectAttempt;
+    bool connectAttempted;
+    float drainTokens;
+    unsigned long lastDrainUpdate;
+    bool inFlight;                    // Queue head published, waiting for confirmation
+    unsigned long rateWindowStart;
+    uint32_t rateWindowSent;
+
+    uint8_t payload[BATCH_MAX_PAYLOAD];
+
+    // Append formatted text to payload; returns false once it no longer fits
+    bool append(size_t& pos, const char* format, ...) {
+        if (pos >= sizeof(payload)) {
+            return false;
+        }
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf((char*)payload + pos, sizeof(payload) - pos, format, args);
+        va_end(args);
+        if (written < 0 || (size_t)written >= sizeof(payload) - pos) {
+            pos = sizeof(payload);
+            return false;
+        }
+        pos += written;
+        return true;
+    }
+
+    // Render stations [first, ...) as one JSON document, stopping before the first
+    // station that no longer fits. Returns the index of the next station to encode.
+    uint8_t encodeBatch(uint8_t first, size_t& length) {
+        size_t pos = 0;
+        uint16_t readings = 0;
+        uint8_t s = first;
+        append(pos, "{\"model\":\"KlimaLogg-Pro\",\"stations\":[");
+        for (; s < stationCount; s++) {
+            const Station& station = stations[s];
+            size_t stationStart = pos;
+            uint16_t stationReadings = 0;
+            // Wall-clock time, or null when it was not known at reception
+            char time[12] = "null";
+            if (station.receivedAt) {
+                snprintf(time, sizeof(time), "%lu", (unsigned long)station.receivedAt);
+            }
+            bool ok = append(pos, "%s{\"id\":%u,\"rssi\":%d,\"time\":%s,\"sensors\":[",
+                             s > first ? "," : "", station.deviceId, station.rssi, time);
+            for (int x = 0; ok && x < 9; x++) {
+                if (!KlimaLoggDecode::isValidTemperature(station.data.temperature[x])) {
+                    continue;
+                }
+                ok = append(pos, "%s{\"ch\":%d,\"%s\":%.1f,\"%s\":%u,\"battery_ok\":%s}",
+                            stationReadings ? "," : "", x,
+                            CurrentWeatherFields::Temperature::KEY, station.data.temperature[x],
+                            CurrentWeatherFields::Humidity::KEY, station.data.humidity[x],
+                            KlimaLoggFrameParser::getBatteryStatus(station.data.alarmData, x) ? "true" : "false");
+                stationReadings++;
+            }
+            // Keep room for the closing brackets of the document
+            ok = ok && append(pos, "]}") && pos + 2 < sizeof(payload);
+            if (!ok) {
+                pos = stationStart;
+                break;
+            }
+            readings += stationReadings;
+        }
+        append(pos, "]}");
+        length = s > first ? pos : 0;
+        stats.lastBatchStations = s - first;
+        stats.lastBatchReadings = readings;
+        stats.lastBatchBytes = length;
+        return s;
+    }
+
+    // A queue that could not be opened (e.g. LittleFS failed) has no capacity
+    bool queueUsable() const {
+        return queue && queue->capacity() > 0;
+    }
+
+    // Queue the batch until it is confirmed, or send it once if there is no queue
+    void deliver(size_t length) {
+        stats.batches++;
+        stats.readingsBatched += stats.lastBatchReadings;
+        if (queueUsable()) {
+            if (queue->push(payload, length)) {
+                stats.messagesQueued++;
+            }
+            return;
+        }
+        if (transport.connected() && transport.publish(payload, length)) {
+            countSent();
+        }
+    }
+
+    void flush() {
+        uint8_t next = 0;
+        while (next < stationCount) {
+            size_t length;
+            uint8_t after = encodeBatch(next, length);
+            if (length == 0) {
+                // A single station does not fit into BATCH_MAX_PAYLOAD, skip it
+                after = next + 1;
+            } else {
+                deliver(length);
+            }
+            next = after;
+        }
+        stationCount = 0;
+    }
+
+    void countSent() {
+        stats.messagesSent++;
+        rateWindowSent++;
+    }
+
+    void drain(unsigned long now) {
+        // Token bucket limits the drain rate after an outage
+        drainTokens += (now - lastDrainUpdate) * config.drainPerSecond / 1000.0f;
+        if (drainTokens > config.drainPerSecond) {
+            drainTokens = config.drainPerSecond;
+        }
+        lastDrainUpdate = now;
+
+        if (inFlight) {
+            PublishTransport::Delivery delivery = transport.lastDelivery();
+            if (delivery == PublishTransport::PENDING) {
+                return;
+            }
+            inFlight = false;
+            if (delivery == PublishTransport::DELIVERED) {
+                queue->pop();
+                countSent();
+            } else {
+                // Still at the head of the queue, sent again after the reconnect
+                stats.messagesRetried++;
+            }
+        }
+
+        while (drainTokens >= 1.0f && !queue->empty() && transport.connected()) {
+            int length = queue->peek(payload);
+            if (length < 0) {
+                queue->pop(); // Unreadable slot, skip it
+                continue;
+            }
+            if (!transport.publish(payload, length)) {
+                break;
+            }
+            drainTokens -= 1.0f;
+            if (transport.lastDelivery() == PublishTransport::PENDING) {
+                inFlight = true;
+                break;
+            }
+            queue->pop();
+            countSent();
+        }
+    }
+
+public:
+    BatchPublisher(PublishTransport& _transport, FlashQueue* _queue = nullptr,
+                   const Config& _config = Config()) :
+        transport(_transport),
+        queue(_queue),
+        config(_config),
+        stationCount(0),
+        windowStart(0),
+        lastConnectAttempt(0),
+        connectAttempted(false),
+        drainTokens(0),
+        lastDrainUpdate(0),
+        inFlight(false),
+        rateWindowStart(0),
+        rateWindowSent(0)
+    {
+        memset(&stats, 0, sizeof(stats));
+    }
+
+    // Add the latest readings of one station to the current batch. receivedAt is
+    // wall-clock Unix seconds (0 if unknown), sent as the station's "time".
+    void add(uint16_t deviceId, const KlimaLoggFrameParser::CurrentData& data,
+             int rssi, uint32_t receivedAt, unsigned long now) {
+        uint8_t s = 0;
+        while (s < stationCount && stations[s].deviceId != deviceId) {
+            s++;
+        }
+        if (s == BATCH_MAX_STATIONS) {
+            // Batch is full, ship it and start a new one
+            flush();
+            s = 0;
+        }
+        if (s == stationCount) {
+            if (stationCount == 0) {
+                windowStart = now;
+            }
+            stationCount++;
+        }
+        // Newer readings of the same station replace older ones within a window
+        stations[s].deviceId = deviceId;
+        stations[s].rssi = rssi;
+        stations[s].receivedAt = receivedAt;
+        stations[s].data = data;
+    }
+
+    // Flush due batches, keep the link up and drain the queue (call this in loop)
+    void loop(unsigned long now) {
+        if (!transport.connected() &&
+            (!connectAttempted || now - lastConnectAttempt >= config.reconnectMs)) {
+            connectAttempted = true;
+            lastConnectAttempt = now;
+            transport.connect();
+        }
+        transport.loop();
+
+        if (stationCount > 0 && now - windowStart >= config.windowMs) {
+            flush();
+        }
+        if (queueUsable()) {
+            drain(now);
+        } else {
+            lastDrainUpdate = now;
+        }
+
+        if (now - rateWindowStart >= config.statsIntervalMs) {
+            stats.messagesPerSecond = rateWindowSent * 1000.0f / (now - rateWindowStart);
+            rateWindowStart = now;
+            rateWindowSent = 0;
+        }
+    }
+
+    const Stats& getStats() {
+        if (queue) {
+            stats.queueDepth = queue->size();
+            stats.queueDropped = queue->dropped();
+        }
+        return stats;
+    }
+};
+
+#endif // BATCH_PUBLISHER_H
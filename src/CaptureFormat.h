@@ -0,0 +1,114 @@
+// CaptureFormat.h
+#ifndef CAPTURE_FORMAT_H
+#define CAPTURE_FORMAT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// On-disk format for archives of raw received frames (little-endian):
+//
+//   file header   8 bytes  "KLCAP01\0"
+//   record        CaptureRecordHeader followed by `length` raw frame bytes
+//
+// Every record starts with a sync word so readers can start at an arbitrary byte
+// offset and find the next record boundary, which lets archives be split into
+// chunks and decoded in parallel without a sequential pre-scan.
+//
+// Timestamps are wall-clock Unix seconds. A receiver whose clock has not been set
+// yet (no SNTP sync since boot) writes TIME_UNKNOWN; such records have no usable
+// time and fall outside every --from/--to range.
+namespace KlimaLoggCapture {
+
+static const char FILE_MAGIC[8] = { 'K', 'L', 'C', 'A', 'P', '0', '1', 0 };
+static const uint16_t RECORD_SYNC = 0xC5A9;
+static const uint16_t MAX_FRAME_LENGTH = 256;
+static const uint32_t TIME_UNKNOWN = 0;
+
+struct __attribute__((packed)) RecordHeader {
+    uint16_t sync;        // RECORD_SYNC
+    uint16_t length;      // Frame bytes that follow
+    uint32_t timestamp;   // Receive time, Unix seconds, or TIME_UNKNOWN
+    int16_t rssi;         // dBm, -999 if unknown
+    uint16_t receiverId;  // Which receiver captured the frame
+};
+
+static_assert(sizeof(RecordHeader) == 12, "capture record header must be 12 bytes");
+
+// Whether a record header looks sane; used when re-synchronising inside a file
+inline bool isPlausible(const RecordHeader& header) {
+    return header.sync == RECORD_SYNC && header.length > 0 &&
+           header.length <= MAX_FRAME_LENGTH;
+}
+
+// Appends records to a capture file
+class Writer {
+private:
+    FILE* file;
+    uint32_t bytes;
+
+public:
+    Writer() : file(nullptr), bytes(0) {}
+    ~Writer() { close(); }
+
+    // Open a capture for appending, creating it if needed, so records of earlier
+    // runs are kept. Fails on a file that is not a capture.
+    bool open(const char* path) {
+        close();
+        file = fopen(path, "a+b");
+        if (!file || fseek(file, 0, SEEK_END) != 0) {
+            close();
+            return false;
+        }
+        long size = ftell(file);
+        if (size == 0) {
+            bytes = sizeof(FILE_MAGIC);
+            return fwrite(FILE_MAGIC, sizeof(FILE_MAGIC), 1, file) == 1;
+        }
+        char magic[sizeof(FILE_MAGIC)];
+        if (size < (long)sizeof(magic) || fseek(file, 0, SEEK_SET) != 0 ||
+            fread(magic, sizeof(magic), 1, file) != 1 ||
+            memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0) {
+            close();
+            return false;
+        }
+        // Writes go to the end in append mode; a record cut short by a reset
+        // before this run is skipped by the readers' resync
+        bytes = (uint32_t)size;
+        return fseek(file, 0, SEEK_END) == 0;
+    }
+
+    // File size, including what earlier runs wrote
+    uint32_t size() const { return bytes; }
+
+    bool write(const uint8_t* frame, uint16_t length, uint32_t timestamp,
+               int16_t rssi, uint16_t receiverId) {
+        if (!file || length == 0 || length > MAX_FRAME_LENGTH) {
+            return false;
+        }
+        RecordHeader header = { RECORD_SYNC, length, timestamp, rssi, receiverId };
+        if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+            fwrite(frame, 1, length, file) != length) {
+            return false;
+        }
+        bytes += sizeof(header) + length;
+        return true;
+    }
+
+    // Get written records onto the medium, so they survive a reset
+    bool commit() {
+        return file && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    }
+
+    void close() {
+        if (file) {
+            fclose(file);
+            file = nullptr;
+        }
+    }
+};
+
+} // namespace KlimaLoggCapture
+
+#endif // CAPTURE_FORMAT_H
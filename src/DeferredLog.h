@@ -0,0 +1,354 @@
+// DeferredLog.h
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <ArduinoLog.h>
+#else
+// Same values as ArduinoLog
+#define LOG_LEVEL_SILENT  0
+#define LOG_LEVEL_FATAL   1
+#define LOG_LEVEL_ERROR   2
+#define LOG_LEVEL_WARNING 3
+#define LOG_LEVEL_NOTICE  4
+#define LOG_LEVEL_TRACE   5
+#define LOG_LEVEL_VERBOSE 6
+#endif
+
+#include "LogMessages.h"
+
+// Messages above this level are compiled out completely
+#ifndef DLOG_LEVEL
+#ifdef LOG_LEVEL
+#define DLOG_LEVEL LOG_LEVEL
+#else
+#define DLOG_LEVEL LOG_LEVEL_NOTICE
+#endif
+#endif
+
+#ifndef DLOG_RING_SIZE
+#define DLOG_RING_SIZE 128   // Records, must be a power of two
+#endif
+
+// Message ids and their compile-time levels, generated from LogMessages.h
+enum class LogMessageId : uint16_t {
+#define DLOG_ENUM_ENTRY(id, level, format) id,
+    KLIMALOGG_LOG_MESSAGES(DLOG_ENUM_ENTRY)
+#undef DLOG_ENUM_ENTRY
+    COUNT
+};
+
+enum : uint8_t {
+#define DLOG_LEVEL_ENTRY(id, level, format) DLOG_LEVEL_OF_##id = level,
+    KLIMALOGG_LOG_MESSAGES(DLOG_LEVEL_ENTRY)
+#undef DLOG_LEVEL_ENTRY
+};
+
+// Log a message by id. The level check is a constant expression, so messages above
+// DLOG_LEVEL cost nothing, not even argument evaluation.
+#define DLOG(id, ...) \
+    do { \
+        if (DLOG_LEVEL_OF_##id <= DLOG_LEVEL) { \
+            deferredLog.write(LogMessageId::id, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+// Raw byte argument, printed as hex by %H
+struct LogBytes {
+    const uint8_t* data;
+    size_t length;
+    LogBytes(const uint8_t* _data, size_t _length) : data(_data), length(_length) {}
+};
+
+// Lock-free multi-producer ring of fixed-size binary log records. Producers copy
+// the message id and raw arguments in; a single consumer (a low-priority task, or
+// the host decoder reading the binary stream) does all the formatting.
+class DeferredLog {
+public:
+    static const size_t MAX_ARGS = 40;
+
+    struct Record {
+        uint32_t timestampUs;
+        uint16_t id;
+        uint8_t length;       // Bytes used in args
+        uint8_t reserved;
+        uint8_t args[MAX_ARGS];
+    };
+
+    struct MessageInfo {
+        uint8_t level;
+        const char* name;
+        const char* format;
+    };
+
+    // Binary stream framing: sync bytes followed by one Record
+    static const uint8_t SYNC0 = 0xD1;
+    static const uint8_t SYNC1 = 0x09;
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        Record record;
+    };
+
+    static const uint32_t MASK = DLOG_RING_SIZE - 1;
+    static_assert((DLOG_RING_SIZE & MASK) == 0, "DLOG_RING_SIZE must be a power of two");
+
+    Slot slots[DLOG_RING_SIZE];
+    std::atomic<uint32_t> enqueuePos;
+    uint32_t dequeuePos;
+    std::atomic<uint32_t> dropped;
+    uint32_t droppedReported;
+
+    // Argument packing: integers as 32 bits, floating point as float,
+    // strings and byte blocks as a length byte followed by the data
+    static void put(Record& r, const void* data, size_t size) {
+        if (r.length + size <= MAX_ARGS) {
+            memcpy(r.args + r.length, data, size);
+            r.length += size;
+        }
+    }
+
+    static void putBlock(Record& r, const uint8_t* data, size_t size) {
+        if (r.length >= MAX_ARGS) return;
+        size_t room = MAX_ARGS - r.length - 1;
+        uint8_t n = size < room ? size : room;
+        r.args[r.length++] = n;
+        memcpy(r.args + r.length, data, n);
+        r.length += n;
+    }
+
+    template <typename T>
+    static void packOne(Record& r, T value, std::true_type /* integral */) {
+        int32_t v = (int32_t)value;
+        put(r, &v, sizeof(v));
+    }
+
+    template <typename T>
+    static void packOne(Record& r, T value, std::false_type /* floating point */) {
+        float v = (float)value;
+        put(r, &v, sizeof(v));
+    }
+
+    template <typename T>
+    static void pack(Record& r, T value) {
+        static_assert(std::is_arithmetic<T>::value, "unsupported DeferredLog argument type");
+        packOne(r, value, std::is_integral<T>());
+    }
+
+    static void pack(Record& r, const char* value) {
+        putBlock(r, (const uint8_t*)value, strlen(value));
+    }
+
+    static void pack(Record& r, const LogBytes& value) {
+        putBlock(r, value.data, value.length);
+    }
+
+    static void packAll(Record&) {}
+
+    template <typename T, typename... Rest>
+    static void packAll(Record& r, const T& first, const Rest&... rest) {
+        pack(r, first);
+        packAll(r, rest...);
+    }
+
+    static uint32_t nowUs() {
+        return micros();
+    }
+
+    bool enqueue(const Record& record) {
+        uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[pos & MASK];
+            uint32_t seq = slot->sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(seq - pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // Full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->record = record;
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+public:
+    DeferredLog() : enqueuePos(0), dequeuePos(0), dropped(0), droppedReported(0) {
+        for (uint32_t i = 0; i < DLOG_RING_SIZE; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Record a message; never blocks, drops the message if the ring is full
+    template <typename... Args>
+    void write(LogMessageId id, const Args&... args) {
+        Record record;
+        record.timestampUs = nowUs();
+        record.id = (uint16_t)id;
+        record.length = 0;
+        record.reserved = 0;
+        packAll(record, args...);
+        if (!enqueue(record)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Take the oldest record (single consumer only)
+    bool read(Record& out) {
+        Slot* slot = &slots[dequeuePos & MASK];
+        uint32_t seq = slot->sequence.load(std::memory_order_acquire);
+        if ((int32_t)(seq - (dequeuePos + 1)) != 0) {
+            return false;
+        }
+        out = slot->record;
+        slot->sequence.store(dequeuePos + MASK + 1, std::memory_order_release);
+        dequeuePos++;
+        return true;
+    }
+
+    uint32_t droppedCount() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+
+    static const MessageInfo* messageInfo(uint16_t id) {
+        static const MessageInfo messages[] = {
+#define DLOG_INFO_ENTRY(id, level, format) { level, #id, format },
+            KLIMALOGG_LOG_MESSAGES(DLOG_INFO_ENTRY)
+#undef DLOG_INFO_ENTRY
+        };
+        return id < (uint16_t)LogMessageId::COUNT ? &messages[id] : nullptr;
+    }
+
+    // Render a record as text (without line ending); returns the text length
+    static size_t format(const Record& record, char* out, size_t size) {
+        const MessageInfo* info = messageInfo(record.id);
+        if (!info) {
+            return snprintf(out, size, "<unknown message %u>", record.id);
+        }
+        static const char LEVEL_LETTERS[] = "SFEWNTV";
+        size_t n = snprintf(out, size, "%lu.%06lu %c: ",
+                            (unsigned long)(record.timestampUs / 1000000),
+                            (unsigned long)(record.timestampUs % 1000000),
+                            info->level < 7 ? LEVEL_LETTERS[info->level] : '?');
+        size_t arg = 0;
+        for (const char* f = info->format; *f && n + 1 < size; f++) {
+            if (*f != '%' || !f[1]) {
+                out[n++] = *f;
+                continue;
+            }
+            char spec = *++f;
+            int written = 0;
+            if (spec == '%') {
+                out[n++] = '%';
+            } else if (spec == 's' || spec == 'H') {
+                uint8_t length = arg < record.length ? record.args[arg++] : 0;
+                length = arg + length <= record.length ? length : 0;
+                for (uint8_t i = 0; i < length && n + 4 < size; i++) {
+                    uint8_t b = record.args[arg + i];
+                    if (spec == 's') {
+                        out[n++] = b;
+                    } else {
+                        n += snprintf(out + n, size - n, "%02X ", b);
+                    }
+                }
+                arg += length;
+            } else if (arg + 4 <= record.length) {
+                int32_t i;
+                float fl;
+                memcpy(&i, record.args + arg, 4);
+                memcpy(&fl, record.args + arg, 4);
+                arg += 4;
+                switch (spec) {
+                    case 'd': written = snprintf(out + n, size - n, "%ld", (long)i); break;
+                    case 'u': written = snprintf(out + n, size - n, "%lu", (unsigned long)(uint32_t)i); break;
+                    case 'x': written = snprintf(out + n, size - n, "%lx", (unsigned long)(uint32_t)i); break;
+                    case 'X': written = snprintf(out + n, size - n, "%lX", (unsigned long)(uint32_t)i); break;
+                    case 'f': written = snprintf(out + n, size - n, "%.2f", fl); break;
+                    default:  written = snprintf(out + n, size - n, "%%%c", spec); break;
+                }
+            }
+            if (written > 0) {
+                n += (size_t)written < size - n ? (size_t)written : size - n - 1;
+            }
+        }
+        out[n < size ? n : size - 1] = 0;
+        return n < size ? n : size - 1;
+    }
+
+    // Write up to maxRecords queued records to out (anything with an Arduino
+    // Print style write(const uint8_t*, size_t)), as text or as a framed binary
+    // stream for tools/log_decode. Returns the number of records written.
+    template <typename Output>
+    size_t drain(Output& out, bool binary, size_t maxRecords = DLOG_RING_SIZE) {
+        Record record;
+        size_t count = 0;
+
+        uint32_t lost = droppedCount();
+        if (lost != droppedReported) {
+            record.timestampUs = nowUs();
+            record.id = (uint16_t)LogMessageId::LOG_OVERRUN;
+            record.length = 0;
+            record.reserved = 0;
+            pack(record, lost - droppedReported);
+            droppedReported = lost;
+            emit(out, record, binary);
+        }
+
+        while (count < maxRecords && read(record)) {
+            emit(out, record, binary);
+            count++;
+        }
+        return count;
+    }
+
+    template <typename Output>
+    static void emit(Output& out, const Record& record, bool binary) {
+        if (binary) {
+            // One write, so text from other tasks on the same port cannot split a frame
+            uint8_t frame[2 + sizeof(Record)];
+            frame[0] = SYNC0;
+            frame[1] = SYNC1;
+            memcpy(frame + 2, &record, sizeof(record));
+            out.write(frame, sizeof(frame));
+        } else {
+            char line[160];
+            size_t n = format(record, line, sizeof(line) - 1);
+            line[n++] = '\n';
+            out.write((const uint8_t*)line, n);
+        }
+    }
+
+#if defined(ARDUINO) && defined(ESP32)
+    // Format and print records from a low-priority task, off the receive path
+    void startTask(Print& out, bool binary = false, UBaseType_t priority = 1) {
+        static Print* output;
+        static bool binaryOutput;
+        output = &out;
+        binaryOutput = binary;
+        xTaskCreatePinnedToCore([](void* self) {
+            for (;;) {
+                if (((DeferredLog*)self)->drain(*output, binaryOutput, 16) == 0) {
+                    vTaskDelay(pdMS_TO_TICKS(20));
+                }
+            }
+        }, "deferredLog", 4096, this, priority, nullptr, 1);
+    }
+#endif
+};
+
+extern DeferredLog deferredLog;
+
+#endif // DEFERRED_LOG_H
@@ -0,0 +1,178 @@
+// FlashQueue.h
+#ifndef FLASH_QUEUE_H
+#define FLASH_QUEUE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Bounded FIFO of messages kept on a filesystem, used to hold batches while the
+// transport is down. Uses plain stdio so it works on any mounted filesystem
+// (LittleFS under /littlefs on the ESP32, a normal directory on the host).
+//
+// Layout: a small state file at `path` (geometry, head, count) and one file per
+// slot at `path.N`. LittleFS rewrites a file from the changed block to its end, so
+// nothing is ever updated in the middle of a large file: a push writes one whole
+// slot file and then the state file, a pop only rewrites the state file. Each
+// step is fsync'ed, so the queue survives a reset. When full, the oldest message
+// is overwritten and counted as dropped.
+class FlashQueue {
+private:
+    struct Header {
+        uint32_t magic;
+        uint16_t capacity;
+        uint16_t slotSize;
+        uint16_t head;   // Oldest message
+        uint16_t count;
+        uint32_t dropped;
+    };
+
+    static const uint32_t MAGIC = 0x4B4C5132; // "KLQ2"
+    static const size_t MAX_PATH = 64;
+    static const size_t SLOT_PATH = MAX_PATH + 6;   // ".65535"
+
+    FILE* file;      // State file, kept open
+    Header header;
+    char path[MAX_PATH];
+
+    static bool commit(FILE* f) {
+        return fflush(f) == 0 && fsync(fileno(f)) == 0;
+    }
+
+    void slotPath(uint16_t slot, char* out) const {
+        snprintf(out, SLOT_PATH, "%s.%u", path, slot);
+    }
+
+    bool writeHeader() {
+        return fseek(file, 0, SEEK_SET) == 0 &&
+               fwrite(&header, sizeof(Header), 1, file) == 1 &&
+               commit(file);
+    }
+
+public:
+    FlashQueue() : file(nullptr) {
+        memset(&header, 0, sizeof(header));
+        path[0] = 0;
+    }
+
+    ~FlashQueue() {
+        end();
+    }
+
+    // Open (or create) the queue. An existing queue with a different geometry
+    // is reset, otherwise queued messages survive a reboot.
+    bool begin(const char* _path, uint16_t capacity, uint16_t slotSize) {
+        end();
+        if (strlen(_path) >= MAX_PATH) {
+            return false;
+        }
+        strcpy(path, _path);
+        file = fopen(path, "r+b");
+        if (file && fread(&header, sizeof(Header), 1, file) == 1 &&
+            header.magic == MAGIC && header.capacity == capacity &&
+            header.slotSize == slotSize && header.head < capacity &&
+            header.count <= capacity) {
+            return true;
+        }
+        if (file) {
+            fclose(file);
+        }
+        file = fopen(path, "w+b");
+        if (!file) {
+            return false;
+        }
+        header.magic = MAGIC;
+        header.capacity = capacity;
+        header.slotSize = slotSize;
+        header.head = 0;
+        header.count = 0;
+        header.dropped = 0;
+        return writeHeader();
+    }
+
+    void end() {
+        if (file) {
+            fclose(file);
+            file = nullptr;
+        }
+    }
+
+    // Append a message, overwriting the oldest one if the queue is full
+    bool push(const uint8_t* payload, uint16_t length) {
+        if (!file || length > header.slotSize) {
+            return false;
+        }
+        uint16_t slot = (header.head + header.count) % header.capacity;
+        char name[SLOT_PATH];
+        slotPath(slot, name);
+        FILE* slotFile = fopen(name, "wb");
+        if (!slotFile) {
+            return false;
+        }
+        bool written = fwrite(&length, sizeof(length), 1, slotFile) == 1 &&
+                       fwrite(payload, 1, length, slotFile) == length &&
+                       commit(slotFile);
+        fclose(slotFile);
+        if (!written) {
+            return false;
+        }
+        if (header.count == header.capacity) {
+            header.head = (header.head + 1) % header.capacity;
+            header.dropped++;
+        } else {
+            header.count++;
+        }
+        return writeHeader();
+    }
+
+    // Copy the oldest message into payload (at least slotSize bytes) without removing it.
+    // Returns its length, or -1 if the queue is empty or unreadable.
+    int peek(uint8_t* payload) {
+        if (!file || header.count == 0) {
+            return -1;
+        }
+        char name[SLOT_PATH];
+        slotPath(header.head, name);
+        FILE* slotFile = fopen(name, "rb");
+        if (!slotFile) {
+            return -1;
+        }
+        uint16_t length;
+        bool ok = fread(&length, sizeof(length), 1, slotFile) == 1 &&
+                  length <= header.slotSize &&
+                  fread(payload, 1, length, slotFile) == length;
+        fclose(slotFile);
+        return ok ? length : -1;
+    }
+
+    // Remove the oldest message. Its slot file stays until it is overwritten.
+    bool pop() {
+        if (!file || header.count == 0) {
+            return false;
+        }
+        header.head = (header.head + 1) % header.capacity;
+        header.count--;
+        return writeHeader();
+    }
+
+    // Close the queue and delete its files
+    void erase() {
+        uint16_t slots = header.capacity;
+        end();
+        char name[SLOT_PATH];
+        for (uint16_t slot = 0; slot < slots; slot++) {
+            slotPath(slot, name);
+            remove(name);
+        }
+        remove(path);
+        memset(&header, 0, sizeof(header));
+    }
+
+    uint16_t size() const { return header.count; }
+    uint16_t capacity() const { return header.capacity; }
+    bool empty() const { return header.count == 0; }
+    uint32_t dropped() const { return header.dropped; }
+};
+
+#endif // FLASH_QUEUE_H
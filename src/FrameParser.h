@@ -1,9 +1,14 @@
+// FrameParser.h
+#ifndef FRAME_PARSER_H
+#define FRAME_PARSER_H
+
 #include <Arduino.h>
 #include "KlimaLoggDecode.h"
+#include "FrameSchema.h"
 
 // Class for parsing KlimaLogg frames
 class KlimaLoggFrameParser {
-private:
+public:
     // Structure for current weather data
     struct CurrentData {
         uint32_t timestamp;
@@ -43,65 +48,28 @@ private:
         }
     };
     
-    // Map to translate between buffer positions and data values for current weather data
-    static const uint16_t BUFMAP[9][10];
-
-public:
+    // Layout of a current weather frame, defined after the class
+    struct CurrentWeatherSchema;
+    
     // Parse a current weather data frame
-    static CurrentData parseCurrentWeatherFrame(uint8_t* buffer, size_t length) {
-        CurrentData data;
-        
-        // Check if buffer has enough data
-        if (length < 230) {
-            Serial.println("Current weather frame too short");
-            return data;
-        }
-        
-        // Set timestamp to current time
-        data.timestamp = millis() / 1000;
-        
-        // Get signal quality
-        data.signalQuality = buffer[4] & 0x7F;
-        
-        // Parse sensor data for all 9 sensors (base + 8 remote)
+    static CurrentData parseCurrentWeatherFrame(const uint8_t* buffer, size_t length);
+    
+    // Build a current weather frame from data (for synthetic test traffic);
+    // buffer must hold at least CurrentWeatherSchema::LENGTH bytes
+    static void encodeCurrentWeatherFrame(const CurrentData& data, uint8_t* buffer, size_t length);
+    
+    // Check whether at least one sensor reported a usable temperature
+    static bool hasValidReadings(const CurrentData& data) {
         for (int x = 0; x < 9; x++) {
-            // Temperature data
-            data.temperatureMax[x] = KlimaLoggDecode::toTemperature_3_1(buffer, BUFMAP[x][0], 0);
-            data.temperatureMin[x] = KlimaLoggDecode::toTemperature_3_1(buffer, BUFMAP[x][1], 1);
-            data.temperature[x] = KlimaLoggDecode::toTemperature_3_1(buffer, BUFMAP[x][2], 0);
-            
-            // Temperature timestamps
-            if (KlimaLoggDecode::isValidTemperature(data.temperatureMax[x])) {
-                data.temperatureMaxTS[x] = KlimaLoggDecode::toDateTime8(buffer, BUFMAP[x][3], 0, "TemperatureMax");
-            }
-            
-            if (KlimaLoggDecode::isValidTemperature(data.temperatureMin[x])) {
-                data.temperatureMinTS[x] = KlimaLoggDecode::toDateTime8(buffer, BUFMAP[x][4], 0, "TemperatureMin");
-            }
-            
-            // Humidity data
-            data.humidityMax[x] = KlimaLoggDecode::toHumidity_2_0(buffer, BUFMAP[x][5], 1);
-            data.humidityMin[x] = KlimaLoggDecode::toHumidity_2_0(buffer, BUFMAP[x][6], 1);
-            data.humidity[x] = KlimaLoggDecode::toHumidity_2_0(buffer, BUFMAP[x][7], 1);
-            
-            // Humidity timestamps
-            if (KlimaLoggDecode::isValidHumidity(data.humidityMax[x])) {
-                data.humidityMaxTS[x] = KlimaLoggDecode::toDateTime8(buffer, BUFMAP[x][8], 1, "HumidityMax");
-            }
-            
-            if (KlimaLoggDecode::isValidHumidity(data.humidityMin[x])) {
-                data.humidityMinTS[x] = KlimaLoggDecode::toDateTime8(buffer, BUFMAP[x][9], 1, "HumidityMin");
+            if (KlimaLoggDecode::isValidTemperature(data.temperature[x])) {
+                return true;
             }
         }
-        
-        // Copy alarm data (12 bytes)
-        memcpy(data.alarmData, &buffer[223], 12);
-        
-        return data;
+        return false;
     }
     
     // Get battery status from alarm data
-    static bool getBatteryStatus(uint8_t* alarmData, int sensorIndex) {
+    static bool getBatteryStatus(const uint8_t* alarmData, int sensorIndex) {
         if (sensorIndex == 0) {
             // Base station
             return ((alarmData[1] & 0x80) == 0);
@@ -114,17 +82,71 @@ public:
     }
 };
 
-// Define the buffer map for current weather data
-// Maps sensor index to buffer positions for different data fields
+// Current weather frame layout, per sensor (base + 8 remote), 24 bytes apart.
 // From the KlimaLogg protocol: BUFMAP = {0: ( 26, 28, 29, 18, 22, 15, 16, 17,  7, 11), ... }
-const uint16_t KlimaLoggFrameParser::BUFMAP[9][10] = {
-    { 26, 28, 29, 18, 22, 15, 16, 17,  7, 11 }, // Sensor 0 (base)
-    { 50, 52, 53, 42, 46, 39, 40, 41, 31, 35 }, // Sensor 1
-    { 74, 76, 77, 66, 70, 63, 64, 65, 55, 59 }, // Sensor 2
-    { 98,100,101, 90, 94, 87, 88, 89, 79, 83 }, // Sensor 3
-    {122,124,125,114,118,111,112,113,103,107 }, // Sensor 4
-    {146,148,149,138,142,135,136,137,127,131 }, // Sensor 5
-    {170,172,173,162,166,159,160,161,151,155 }, // Sensor 6
-    {194,196,197,186,190,183,184,185,175,179 }, // Sensor 7
-    {218,220,221,210,214,207,208,209,199,203 }  // Sensor 8
-};
\ No newline at end of file
+// Timestamps are only decoded when the value they belong to is present.
+namespace CurrentWeatherFields {
+    using namespace FrameSchema;
+    typedef KlimaLoggFrameParser::CurrentData D;
+    
+    struct TemperatureMax : ChannelField<Temperature_3_1, 26, Nibble::Lo, &D::temperatureMax> {};
+    struct TemperatureMin : ChannelField<Temperature_3_1, 28, Nibble::Hi, &D::temperatureMin> {};
+    struct Temperature : ChannelField<Temperature_3_1, 29, Nibble::Lo, &D::temperature> {
+        static constexpr const char* KEY = "temp_C";
+    };
+    struct TemperatureMaxTS : ChannelField<DateTime8, 18, Nibble::Lo, &D::temperatureMaxTS, &D::temperatureMax> {
+        static constexpr const char* NAME = "TemperatureMax";
+    };
+    struct TemperatureMinTS : ChannelField<DateTime8, 22, Nibble::Lo, &D::temperatureMinTS, &D::temperatureMin> {
+        static constexpr const char* NAME = "TemperatureMin";
+    };
+    struct HumidityMax : ChannelField<Humidity_2_0, 15, Nibble::Hi, &D::humidityMax> {};
+    struct HumidityMin : ChannelField<Humidity_2_0, 16, Nibble::Hi, &D::humidityMin> {};
+    struct Humidity : ChannelField<Humidity_2_0, 17, Nibble::Hi, &D::humidity> {
+        static constexpr const char* KEY = "humidity";
+    };
+    struct HumidityMaxTS : ChannelField<DateTime8, 7, Nibble::Hi, &D::humidityMaxTS, &D::humidityMax> {
+        static constexpr const char* NAME = "HumidityMax";
+    };
+    struct HumidityMinTS : ChannelField<DateTime8, 11, Nibble::Hi, &D::humidityMinTS, &D::humidityMin> {
+        static constexpr const char* NAME = "HumidityMin";
+    };
+    
+    typedef Channels<24, 9,
+        TemperatureMax, TemperatureMin, Temperature, TemperatureMaxTS, TemperatureMinTS,
+        HumidityMax, HumidityMin, Humidity, HumidityMaxTS, HumidityMinTS> Sensors;
+    
+    typedef ByteField<4, 0x7F, &D::signalQuality> SignalQuality;
+    
+    // Alarm data runs past the 230 bytes needed for the readings and is only
+    // taken from frames long enough to contain it
+    typedef BytesField<223, 12, &D::alarmData, true> AlarmData;
+}
+
+struct KlimaLoggFrameParser::CurrentWeatherSchema : FrameSchema::Schema<230,
+    CurrentWeatherFields::SignalQuality,
+    CurrentWeatherFields::Sensors,
+    CurrentWeatherFields::AlarmData> {};
+
+inline KlimaLoggFrameParser::CurrentData
+KlimaLoggFrameParser::parseCurrentWeatherFrame(const uint8_t* buffer, size_t length) {
+    CurrentData data;
+    
+    // Check if buffer has enough data
+    if (length < CurrentWeatherSchema::LENGTH) {
+        DLOG(RX_TOO_SHORT, length);
+        return data;
+    }
+    
+    // Set timestamp to current time
+    data.timestamp = millis() / 1000;
+    
+    CurrentWeatherSchema::decode(buffer, length, data);
+    return data;
+}
+
+inline void KlimaLoggFrameParser::encodeCurrentWeatherFrame(const CurrentData& data, uint8_t* buffer, size_t length) {
+    CurrentWeatherSchema::encode(buffer, length, data);
+}
+
+#endif // FRAME_PARSER_H
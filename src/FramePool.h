@@ -0,0 +1,176 @@
+// FramePool.h
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef FRAME_POOL_SLOTS
+#define FRAME_POOL_SLOTS 16    // Frames in flight, at most 32
+#endif
+
+#ifndef FRAME_POOL_FRAME_SIZE
+#define FRAME_POOL_FRAME_SIZE 256
+#endif
+
+class FramePool;
+
+// Move-only, reference-counted handle to a pooled frame buffer. Consumers that keep
+// the raw bytes past the receive callback take their own reference with share()
+// instead of copying; the buffer goes back to the pool when the last handle is
+// released or destroyed.
+class FrameHandle {
+private:
+    FramePool* pool;
+    uint8_t slot;
+
+    friend class FramePool;
+    FrameHandle(FramePool* _pool, uint8_t _slot) : pool(_pool), slot(_slot) {}
+
+public:
+    FrameHandle() : pool(nullptr), slot(0) {}
+    FrameHandle(FrameHandle&& other) : pool(other.pool), slot(other.slot) {
+        other.pool = nullptr;
+    }
+    FrameHandle& operator=(FrameHandle&& other) {
+        if (this != &other) {
+            release();
+            pool = other.pool;
+            slot = other.slot;
+            other.pool = nullptr;
+        }
+        return *this;
+    }
+    FrameHandle(const FrameHandle&) = delete;
+    FrameHandle& operator=(const FrameHandle&) = delete;
+    ~FrameHandle() { release(); }
+
+    // Another reference to the same buffer
+    inline FrameHandle share() const;
+    inline void release();
+
+    bool valid() const { return pool != nullptr; }
+    explicit operator bool() const { return valid(); }
+
+    inline uint8_t* data();
+    inline const uint8_t* data() const;
+    inline size_t length() const;
+    inline void setLength(size_t length);
+    inline int rssi() const;
+    inline void setRssi(int rssi);
+    static size_t capacity() { return FRAME_POOL_FRAME_SIZE; }
+};
+
+// Fixed set of frame buffers, allocated with the pool and never on the heap.
+// Free slots are tracked in one atomic bitmask, so acquire() and the last release()
+// are lock-free and safe from any task.
+class FramePool {
+public:
+    struct Stats {
+        uint32_t acquired;      // Frames handed out
+        uint32_t exhausted;     // acquire() calls that found no free slot
+        uint32_t inUse;         // Frames currently held
+        uint32_t highWater;     // Most frames held at once
+    };
+
+private:
+    static_assert(FRAME_POOL_SLOTS > 0 && FRAME_POOL_SLOTS <= 32, "FRAME_POOL_SLOTS must be 1..32");
+
+    struct Slot {
+        std::atomic<uint16_t> refs;
+        uint16_t length;
+        int16_t rssi;
+        uint8_t data[FRAME_POOL_FRAME_SIZE];
+    };
+
+    Slot slots[FRAME_POOL_SLOTS];
+    std::atomic<uint32_t> freeMask;
+    std::atomic<uint32_t> acquiredCount;
+    std::atomic<uint32_t> exhaustedCount;
+    std::atomic<uint32_t> inUseCount;
+    std::atomic<uint32_t> highWaterMark;
+
+    friend class FrameHandle;
+
+    void retain(uint8_t slot) {
+        slots[slot].refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release(uint8_t slot) {
+        if (slots[slot].refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            inUseCount.fetch_sub(1, std::memory_order_relaxed);
+            freeMask.fetch_or(1u << slot, std::memory_order_release);
+        }
+    }
+
+public:
+    FramePool() : acquiredCount(0), exhaustedCount(0), inUseCount(0), highWaterMark(0) {
+        for (int i = 0; i < FRAME_POOL_SLOTS; i++) {
+            slots[i].refs.store(0, std::memory_order_relaxed);
+        }
+        freeMask.store(FRAME_POOL_SLOTS == 32 ? 0xFFFFFFFFu : (1u << FRAME_POOL_SLOTS) - 1,
+                       std::memory_order_relaxed);
+    }
+
+    // Take a free buffer with length 0; an empty handle if all are in use
+    FrameHandle acquire() {
+        uint32_t mask = freeMask.load(std::memory_order_relaxed);
+        uint8_t slot;
+        do {
+            if (mask == 0) {
+                exhaustedCount.fetch_add(1, std::memory_order_relaxed);
+                return FrameHandle();
+            }
+            slot = __builtin_ctz(mask);
+        } while (!freeMask.compare_exchange_weak(mask, mask & ~(1u << slot),
+                                                 std::memory_order_acquire, std::memory_order_relaxed));
+
+        slots[slot].refs.store(1, std::memory_order_relaxed);
+        slots[slot].length = 0;
+        slots[slot].rssi = 0;
+        acquiredCount.fetch_add(1, std::memory_order_relaxed);
+        uint32_t inUse = inUseCount.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint32_t high = highWaterMark.load(std::memory_order_relaxed);
+        while (inUse > high && !highWaterMark.compare_exchange_weak(high, inUse, std::memory_order_relaxed)) {
+        }
+        return FrameHandle(this, slot);
+    }
+
+    Stats getStats() const {
+        Stats s;
+        s.acquired = acquiredCount.load(std::memory_order_relaxed);
+        s.exhausted = exhaustedCount.load(std::memory_order_relaxed);
+        s.inUse = inUseCount.load(std::memory_order_relaxed);
+        s.highWater = highWaterMark.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    static size_t size() { return FRAME_POOL_SLOTS; }
+};
+
+inline FrameHandle FrameHandle::share() const {
+    if (!pool) {
+        return FrameHandle();
+    }
+    pool->retain(slot);
+    return FrameHandle(pool, slot);
+}
+
+inline void FrameHandle::release() {
+    if (pool) {
+        pool->release(slot);
+        pool = nullptr;
+    }
+}
+
+inline uint8_t* FrameHandle::data() { return pool->slots[slot].data; }
+inline const uint8_t* FrameHandle::data() const { return pool->slots[slot].data; }
+inline size_t FrameHandle::length() const { return pool->slots[slot].length; }
+inline void FrameHandle::setLength(size_t length) {
+    pool->slots[slot].length = length < FRAME_POOL_FRAME_SIZE ? length : FRAME_POOL_FRAME_SIZE;
+}
+inline int FrameHandle::rssi() const { return pool->slots[slot].rssi; }
+inline void FrameHandle::setRssi(int rssi) { pool->slots[slot].rssi = rssi; }
+
+#endif // FRAME_POOL_H
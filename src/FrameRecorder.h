@@ -0,0 +1,148 @@
+// FrameRecorder.h
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include <atomic>
+#include <stdint.h>
+#include "CaptureFormat.h"
+#include "FramePool.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+#ifndef FRAME_RECORDER_QUEUE
+#define FRAME_RECORDER_QUEUE 8   // Frames waiting for the file, must be a power of two
+#endif
+
+// Records raw received frames to a capture file (CaptureFormat.h) for replay and
+// export with the host tools. The receive path hands over a shared reference to
+// the pooled buffer instead of a copy; a low-priority task does the slow flash
+// write and the buffer goes back to the pool once it is on file. When the queue is
+// full or the file has reached its size limit, frames are dropped, never waited for.
+//
+// The capture is appended to across restarts, up to maxBytes in total, and each
+// batch of records is fsync'ed like FlashQueue does. Timestamps must be wall-clock
+// Unix seconds (or KlimaLoggCapture::TIME_UNKNOWN), see CaptureFormat.h.
+class FrameRecorder {
+public:
+    struct Stats {
+        uint32_t recorded;    // Frames written to the file
+        uint32_t dropped;     // Frames lost to a full queue or a failed write
+        uint32_t bytes;       // File size so far
+        bool full;            // Size limit reached, recording stopped
+    };
+
+private:
+    struct Entry {
+        FrameHandle frame;
+        uint32_t timestamp;
+    };
+
+    static const uint32_t MASK = FRAME_RECORDER_QUEUE - 1;
+    static_assert((FRAME_RECORDER_QUEUE & MASK) == 0, "FRAME_RECORDER_QUEUE must be a power of two");
+
+    Entry entries[FRAME_RECORDER_QUEUE];
+    std::atomic<uint32_t> head;       // Next entry to fill (receive path)
+    std::atomic<uint32_t> tail;       // Next entry to write (recorder task)
+    KlimaLoggCapture::Writer writer;
+    uint32_t maxBytes;
+    uint16_t receiverId;
+    std::atomic<uint32_t> recorded;
+    std::atomic<uint32_t> dropped;
+    std::atomic<uint32_t> bytes;
+    std::atomic<bool> recording;
+
+public:
+    FrameRecorder() :
+        head(0), tail(0), maxBytes(0), receiverId(0),
+        recorded(0), dropped(0), bytes(0), recording(false) {}
+
+    // Open the capture file, appending to an existing one
+    bool begin(const char* path, uint32_t _maxBytes, uint16_t _receiverId = 0) {
+        maxBytes = _maxBytes;
+        receiverId = _receiverId;
+        if (!writer.open(path)) {
+            return false;
+        }
+        bytes.store(writer.size(), std::memory_order_relaxed);
+        recording.store(true, std::memory_order_release);
+        return true;
+    }
+
+    // Queue a frame for recording (single producer: the receive path). Takes its
+    // own reference, so the caller keeps using and releasing its handle as usual.
+    bool add(const FrameHandle& frame, uint32_t timestamp) {
+        if (!frame || !recording.load(std::memory_order_acquire)) {
+            return false;
+        }
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= FRAME_RECORDER_QUEUE) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        Entry& entry = entries[h & MASK];
+        entry.frame = frame.share();
+        entry.timestamp = timestamp;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Write queued frames to the file and release them (single consumer).
+    // Returns the number of frames taken off the queue.
+    size_t drain(size_t maxFrames = FRAME_RECORDER_QUEUE) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        uint32_t h = head.load(std::memory_order_acquire);
+        size_t taken = 0;
+        while (t != h && taken < maxFrames) {
+            Entry& entry = entries[t & MASK];
+            uint32_t size = sizeof(KlimaLoggCapture::RecordHeader) + entry.frame.length();
+            uint32_t used = bytes.load(std::memory_order_relaxed);
+            if (recording.load(std::memory_order_relaxed) && used + size > maxBytes) {
+                // Keep what is on file readable and stop
+                writer.commit();
+                writer.close();
+                recording.store(false, std::memory_order_release);
+            }
+            if (recording.load(std::memory_order_relaxed) &&
+                writer.write(entry.frame.data(), entry.frame.length(), entry.timestamp,
+                             entry.frame.rssi(), receiverId)) {
+                bytes.store(used + size, std::memory_order_relaxed);
+                recorded.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            entry.frame.release();
+            tail.store(++t, std::memory_order_release);
+            taken++;
+        }
+        if (taken && recording.load(std::memory_order_relaxed)) {
+            writer.commit();
+        }
+        return taken;
+    }
+
+    Stats getStats() const {
+        Stats s;
+        s.recorded = recorded.load(std::memory_order_relaxed);
+        s.dropped = dropped.load(std::memory_order_relaxed);
+        s.bytes = bytes.load(std::memory_order_relaxed);
+        s.full = !recording.load(std::memory_order_relaxed) && s.bytes > 0;
+        return s;
+    }
+
+#if defined(ARDUINO) && defined(ESP32)
+    // Write frames from a low-priority task, off the receive path
+    void startTask(UBaseType_t priority = 1) {
+        xTaskCreatePinnedToCore([](void* self) {
+            for (;;) {
+                if (((FrameRecorder*)self)->drain() == 0) {
+                    vTaskDelay(pdMS_TO_TICKS(50));
+                }
+            }
+        }, "frameRecorder", 4096, this, priority, nullptr, 1);
+    }
+#endif
+};
+
+#endif // FRAME_RECORDER_H
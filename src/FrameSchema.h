@@ -0,0 +1,357 @@
+// FrameSchema.h
+#ifndef FRAME_SCHEMA_H
+#define FRAME_SCHEMA_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include "DeferredLog.h"
+#include "KlimaLoggDecode.h"
+
+// Compile-time description of KlimaLogg frame layouts. A frame type is written as a
+// Schema of fields (byte offset, nibble alignment, codec, destination member); the
+// templates below turn it into a fully unrolled decoder and a matching encoder, and
+// check every field against the frame length with static_assert.
+//
+// Codecs work on the frame as a stream of BCD nibbles: nibble position
+// 2 * offset is the high nibble of that byte, 2 * offset + 1 the low nibble. All
+// positions are template arguments, so the generated code has no table lookups.
+namespace FrameSchema {
+
+// Which nibble of the first byte a field starts on
+enum class Nibble : uint8_t { Lo = 0, Hi = 1 };
+
+constexpr unsigned nibblePosition(uint16_t offset, Nibble align) {
+    return 2u * offset + (align == Nibble::Hi ? 0u : 1u);
+}
+
+template <unsigned Pos>
+inline uint8_t getNibble(const uint8_t* buf) {
+    return (Pos & 1) ? (buf[Pos / 2] & 0xF) : (buf[Pos / 2] >> 4);
+}
+
+template <unsigned Pos>
+inline void setNibble(uint8_t* buf, uint8_t value) {
+    if (Pos & 1) {
+        buf[Pos / 2] = (buf[Pos / 2] & 0xF0) | (value & 0xF);
+    } else {
+        buf[Pos / 2] = (buf[Pos / 2] & 0x0F) | (value << 4);
+    }
+}
+
+// Nibble n of a field is an error digit (10-14) or an overflow digit (15)
+template <unsigned Pos, unsigned... N>
+inline bool anyError(const uint8_t* buf, std::integer_sequence<unsigned, N...>) {
+    return ((getNibble<Pos + N>(buf) >= 10 && getNibble<Pos + N>(buf) != 15) || ...);
+}
+
+template <unsigned Pos, unsigned... N>
+inline bool anyOverflow(const uint8_t* buf, std::integer_sequence<unsigned, N...>) {
+    return ((getNibble<Pos + N>(buf) == 15) || ...);
+}
+
+template <unsigned Pos, unsigned... N>
+inline void fillNibbles(uint8_t* buf, uint8_t value, std::integer_sequence<unsigned, N...>) {
+    (setNibble<Pos + N>(buf, value), ...);
+}
+
+// Temperature, 3 BCD nibbles with one decimal, offset by 40 degrees
+struct Temperature_3_1 {
+    typedef float Value;
+    static constexpr unsigned NIBBLES = 3;
+    static constexpr Value NP = KlimaLoggDecode::TEMPERATURE_NP;
+    static constexpr Value OFL = KlimaLoggDecode::TEMPERATURE_OFL;
+
+    template <unsigned Pos>
+    static Value decode(const uint8_t* buf, const char*) {
+        auto nibbles = std::make_integer_sequence<unsigned, NIBBLES>();
+        if (anyError<Pos>(buf, nibbles)) {
+            return NP;
+        }
+        if (anyOverflow<Pos>(buf, nibbles)) {
+            return OFL;
+        }
+        float rawtemp = getNibble<Pos>(buf) * 10
+                      + getNibble<Pos + 1>(buf) * 1
+                      + getNibble<Pos + 2>(buf) * 0.1;
+        return rawtemp - KlimaLoggDecode::TEMPERATURE_OFFSET;
+    }
+
+    template <unsigned Pos>
+    static void encode(uint8_t* buf, Value value) {
+        auto nibbles = std::make_integer_sequence<unsigned, NIBBLES>();
+        if (value == NP) {
+            fillNibbles<Pos>(buf, 10, nibbles);
+        } else if (value == OFL) {
+            fillNibbles<Pos>(buf, 15, nibbles);
+        } else {
+            int raw = (int)lroundf((value + KlimaLoggDecode::TEMPERATURE_OFFSET) * 10);
+            raw = raw < 0 ? 0 : raw > 999 ? 999 : raw;
+            setNibble<Pos>(buf, raw / 100);
+            setNibble<Pos + 1>(buf, raw / 10 % 10);
+            setNibble<Pos + 2>(buf, raw % 10);
+        }
+    }
+};
+
+// Relative humidity, 2 BCD nibbles
+struct Humidity_2_0 {
+    typedef uint8_t Value;
+    static constexpr unsigned NIBBLES = 2;
+    static constexpr Value NP = (Value)KlimaLoggDecode::HUMIDITY_NP;
+    static constexpr Value OFL = (Value)KlimaLoggDecode::HUMIDITY_OFL;
+
+    template <unsigned Pos>
+    static Value decode(const uint8_t* buf, const char*) {
+        auto nibbles = std::make_integer_sequence<unsigned, NIBBLES>();
+        if (anyError<Pos>(buf, nibbles)) {
+            return NP;
+        }
+        if (anyOverflow<Pos>(buf, nibbles)) {
+            return OFL;
+        }
+        return getNibble<Pos>(buf) * 10 + getNibble<Pos + 1>(buf);
+    }
+
+    template <unsigned Pos>
+    static void encode(uint8_t* buf, Value value) {
+        auto nibbles = std::make_integer_sequence<unsigned, NIBBLES>();
+        if (value == NP) {
+            fillNibbles<Pos>(buf, 10, nibbles);
+        } else if (value == OFL) {
+            fillNibbles<Pos>(buf, 15, nibbles);
+        } else {
+            value = value > 99 ? 99 : value;
+            setNibble<Pos>(buf, value / 10);
+            setNibble<Pos + 1>(buf, value % 10);
+        }
+    }
+};
+
+// Date and time, 8 nibbles: YY M DD then hours/minutes packed into 3 nibbles
+struct DateTime8 {
+    typedef uint32_t Value;
+    static constexpr unsigned NIBBLES = 8;
+
+    template <unsigned Pos>
+    static bool isNotSet(const uint8_t* buf) {
+        return getNibble<Pos>(buf) == 10 && getNibble<Pos + 1>(buf) == 10 &&
+               getNibble<Pos + 2>(buf) == 4 && getNibble<Pos + 3>(buf) == 10 &&
+               getNibble<Pos + 4>(buf) == 10 && getNibble<Pos + 5>(buf) == 4 &&
+               getNibble<Pos + 6>(buf) == 10 && getNibble<Pos + 7>(buf) == 10;
+    }
+
+    template <unsigned Pos>
+    static Value decode(const uint8_t* buf, const char* label) {
+        if (isNotSet<Pos>(buf)) {
+            DLOG(TS_NOT_SET, label);
+            return 0;
+        }
+        int year = getNibble<Pos>(buf) * 10 + getNibble<Pos + 1>(buf) + 2000;
+        int month = getNibble<Pos + 2>(buf);
+        int days = getNibble<Pos + 3>(buf) * 10 + getNibble<Pos + 4>(buf);
+        int tim1 = getNibble<Pos + 5>(buf);
+        int tim2 = getNibble<Pos + 6>(buf);
+        int tim3 = getNibble<Pos + 7>(buf);
+
+        int hours = tim1 >= 10 ? tim1 + 10 : tim1;
+        int minutes;
+        if (tim2 >= 10) {
+            hours += 10;
+            minutes = (tim2 - 10) * 10;
+        } else {
+            minutes = tim2 * 10;
+        }
+        minutes += tim3;
+
+        if (month < 1 || month > 12 || days < 1 || days > 31 ||
+            hours < 0 || hours > 23 || minutes < 0 || minutes > 59) {
+            DLOG(TS_BAD_DATE, label);
+            return 0;
+        }
+        return KlimaLoggDecode::toUnixTime(year, month, days, hours, minutes);
+    }
+
+    template <unsigned Pos>
+    static void encode(uint8_t* buf, Value value) {
+        if (value == 0) {
+            static const uint8_t NOT_SET[NIBBLES] = { 10, 10, 4, 10, 10, 4, 10, 10 };
+            setAll<Pos>(buf, NOT_SET, std::make_integer_sequence<unsigned, NIBBLES>());
+            return;
+        }
+        // Inverse of KlimaLoggDecode::toUnixTime (days-from-civil)
+        int32_t z = value / 86400 + 719468;
+        int era = z / 146097;
+        int dayOfEra = z - era * 146097;
+        int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        int mp = (5 * dayOfYear + 2) / 153;
+        int day = dayOfYear - (153 * mp + 2) / 5 + 1;
+        int month = mp < 10 ? mp + 3 : mp - 9;
+        int year = yearOfEra + era * 400 + (month <= 2);
+        int hours = value % 86400 / 3600;
+        int minutes = value % 3600 / 60;
+
+        // Hours 10-19 are flagged by adding 10 to the tens-of-minutes nibble
+        int tim1 = hours >= 10 ? hours - 10 : hours;
+        int tim2 = minutes / 10 + (hours >= 10 && hours < 20 ? 10 : 0);
+        const uint8_t nibbles[NIBBLES] = {
+            (uint8_t)((year - 2000) / 10 % 10), (uint8_t)((year - 2000) % 10), (uint8_t)month,
+            (uint8_t)(day / 10), (uint8_t)(day % 10),
+            (uint8_t)tim1, (uint8_t)tim2, (uint8_t)(minutes % 10)
+        };
+        setAll<Pos>(buf, nibbles, std::make_integer_sequence<unsigned, NIBBLES>());
+    }
+
+    template <unsigned Pos, unsigned... N>
+    static void setAll(uint8_t* buf, const uint8_t* values, std::integer_sequence<unsigned, N...>) {
+        (setNibble<Pos + N>(buf, values[N]), ...);
+    }
+};
+
+inline bool isPresent(float value) { return KlimaLoggDecode::isValidTemperature(value); }
+inline bool isPresent(uint8_t value) { return KlimaLoggDecode::isValidHumidity(value); }
+
+// Per-channel field: channel c starts at Offset + c * stride bytes. Guard, if given,
+// is the member whose value must be present for this field to be decoded at all.
+template <typename Codec, uint16_t Offset, Nibble Align, auto Member, auto Guard = nullptr>
+struct ChannelField {
+    static constexpr const char* NAME = "";
+    static constexpr unsigned FIRST_NIBBLE = nibblePosition(Offset, Align);
+    static constexpr unsigned LAST_BYTE = (FIRST_NIBBLE + Codec::NIBBLES - 1) / 2;
+
+    template <unsigned Channel, uint16_t Stride, typename Data>
+    static void decode(const uint8_t* buf, Data& data, const char* name) {
+        constexpr unsigned pos = FIRST_NIBBLE + 2u * Channel * Stride;
+        if constexpr (!std::is_same<decltype(Guard), std::nullptr_t>::value) {
+            if (!isPresent((data.*Guard)[Channel])) {
+                return;
+            }
+        }
+        (data.*Member)[Channel] = Codec::template decode<pos>(buf, name);
+    }
+
+    template <unsigned Channel, uint16_t Stride, typename Data>
+    static void encode(uint8_t* buf, const Data& data) {
+        constexpr unsigned pos = FIRST_NIBBLE + 2u * Channel * Stride;
+        typename Codec::Value value = (data.*Member)[Channel];
+        if constexpr (!std::is_same<decltype(Guard), std::nullptr_t>::value) {
+            if (!isPresent((data.*Guard)[Channel])) {
+                value = 0;
+            }
+        }
+        Codec::template encode<pos>(buf, value);
+    }
+};
+
+// Fields repeated for Count channels, Stride bytes apart
+template <uint16_t Stride, uint8_t Count, typename... Fields>
+struct Channels {
+    static constexpr unsigned LAST_BYTE =
+        (Count - 1) * Stride + std::max({ Fields::LAST_BYTE... });
+    static constexpr size_t END = LAST_BYTE + 1;
+    static constexpr size_t MIN_LENGTH = END;
+
+    template <unsigned C, typename Data>
+    static void decodeChannel(const uint8_t* buf, Data& data) {
+        (Fields::template decode<C, Stride>(buf, data, Fields::NAME), ...);
+    }
+
+    template <unsigned C, typename Data>
+    static void encodeChannel(uint8_t* buf, const Data& data) {
+        (Fields::template encode<C, Stride>(buf, data), ...);
+    }
+
+    template <typename Data, unsigned... C>
+    static void decodeAll(const uint8_t* buf, Data& data, std::integer_sequence<unsigned, C...>) {
+        (decodeChannel<C>(buf, data), ...);
+    }
+
+    template <typename Data, unsigned... C>
+    static void encodeAll(uint8_t* buf, const Data& data, std::integer_sequence<unsigned, C...>) {
+        (encodeChannel<C>(buf, data), ...);
+    }
+
+    template <typename Data>
+    static void decode(const uint8_t* buf, size_t, Data& data) {
+        decodeAll(buf, data, std::make_integer_sequence<unsigned, Count>());
+    }
+
+    template <typename Data>
+    static void encode(uint8_t* buf, size_t, const Data& data) {
+        encodeAll(buf, data, std::make_integer_sequence<unsigned, Count>());
+    }
+};
+
+// Single byte, masked
+template <uint16_t Offset, uint8_t Mask, auto Member>
+struct ByteField {
+    static constexpr size_t END = Offset + 1;
+    static constexpr size_t MIN_LENGTH = END;
+
+    template <typename Data>
+    static void decode(const uint8_t* buf, size_t, Data& data) {
+        data.*Member = buf[Offset] & Mask;
+    }
+
+    template <typename Data>
+    static void encode(uint8_t* buf, size_t, const Data& data) {
+        buf[Offset] = (buf[Offset] & ~Mask) | (data.*Member & Mask);
+    }
+};
+
+// Raw byte block. Optional blocks may lie beyond the frame's minimum length and are
+// only decoded when the received frame is long enough.
+template <uint16_t Offset, uint16_t Length, auto Member, bool Optional = false>
+struct BytesField {
+    static constexpr size_t END = Offset + Length;
+    static constexpr size_t MIN_LENGTH = Optional ? 0 : END;
+
+    template <typename Data>
+    static void decode(const uint8_t* buf, size_t length, Data& data) {
+        if (Optional && length < END) {
+            return;
+        }
+        memcpy(data.*Member, buf + Offset, Length);
+    }
+
+    template <typename Data>
+    static void encode(uint8_t* buf, size_t length, const Data& data) {
+        if (Optional && length < END) {
+            return;
+        }
+        memcpy(buf + Offset, data.*Member, Length);
+    }
+};
+
+// A frame type: its minimum length and its fields. The static_assert rejects any
+// schema with a mandatory field that does not fit into FrameLength bytes.
+template <size_t FrameLength, typename... Fields>
+struct Schema {
+    static constexpr size_t LENGTH = FrameLength;
+    // Length with every optional field present
+    static constexpr size_t FULL_LENGTH = std::max({ FrameLength, Fields::END... });
+    static_assert(((Fields::MIN_LENGTH <= FrameLength) && ...),
+                  "frame schema field extends past the frame length");
+
+    // Decode a frame of at least LENGTH bytes
+    template <typename Data>
+    static void decode(const uint8_t* buf, size_t length, Data& data) {
+        (Fields::decode(buf, length, data), ...);
+    }
+
+    // Write data into buf, which must hold at least LENGTH bytes. Bytes not
+    // covered by the schema are left untouched.
+    template <typename Data>
+    static void encode(uint8_t* buf, size_t length, const Data& data) {
+        (Fields::encode(buf, length, data), ...);
+    }
+};
+
+} // namespace FrameSchema
+
+#endif // FRAME_SCHEMA_H
@@ -2,9 +2,11 @@
 #ifndef KLIMALOGG_DECODE_H
 #define KLIMALOGG_DECODE_H
 
-#include <Arduino.h>
+#include <stdint.h>
 
-// Based on the provided Python code, this is a C++ version of the KlimaLogg decoding functions
+// Based on the provided Python code, this is a C++ version of the KlimaLogg decoding functions.
+// The field codecs themselves live in FrameSchema.h; this class keeps the shared
+// limits, validity checks and the date arithmetic.
 class KlimaLoggDecode {
 public:
     // Temperature and humidity limit constants
@@ -27,242 +29,19 @@ public:
         return (value != HUMIDITY_NP && value != HUMIDITY_OFL);
     }
     
-    // Temperature decoding - 3 nibbles with 1 decimal place
-    static float toTemperature_3_1(uint8_t* buf, int start, bool startOnHiNibble) {
-        if (isErr3(buf, start, startOnHiNibble)) {
-            return TEMPERATURE_NP;
-        }
-        else if (isOFL3(buf, start, startOnHiNibble)) {
-            return TEMPERATURE_OFL;
-        }
-        else {
-            float rawtemp;
-            if (startOnHiNibble) {
-                rawtemp = (buf[start] >> 4) * 10 
-                        + (buf[start + 0] & 0xF) * 1 
-                        + (buf[start + 1] >> 4) * 0.1;
-            }
-            else {
-                rawtemp = (buf[start] & 0xF) * 10 
-                        + (buf[start + 1] >> 4) * 1 
-                        + (buf[start + 1] & 0xF) * 0.1;
-            }
-            return rawtemp - TEMPERATURE_OFFSET;
-        }
-    }
-    
-    // Humidity decoding - 2 nibbles with 0 decimal places
-    static uint8_t toHumidity_2_0(uint8_t* buf, int start, bool startOnHiNibble) {
-        if (isErr2(buf, start, startOnHiNibble)) {
-            return HUMIDITY_NP;
-        }
-        else if (isOFL2(buf, start, startOnHiNibble)) {
-            return HUMIDITY_OFL;
-        }
-        else {
-            if (startOnHiNibble) {
-                return (buf[start] >> 4) * 10 + (buf[start] & 0xF);
-            }
-            else {
-                return (buf[start] & 0xF) * 10 + (buf[start + 1] >> 4);
-            }
-        }
-    }
-    
-    // DateTime conversion - 10 nibbles
-    static uint32_t toDateTime10(uint8_t* buf, int start, bool startOnHiNibble, const char* label) {
-        if (isErr2(buf, start + 0, startOnHiNibble) || 
-            isErr2(buf, start + 1, startOnHiNibble) || 
-            isErr2(buf, start + 2, startOnHiNibble) || 
-            isErr2(buf, start + 3, startOnHiNibble) || 
-            isErr2(buf, start + 4, startOnHiNibble)) {
-            
-            Serial.print("ToDateTime: bogus date for ");
-            Serial.println(label);
-            return 0; // Invalid timestamp
-        }
-        else {
-            int year = toInt_2(buf, start + 0, startOnHiNibble) + 2000;
-            int month = toInt_2(buf, start + 1, startOnHiNibble);
-            int days = toInt_2(buf, start + 2, startOnHiNibble);
-            int hours = toInt_2(buf, start + 3, startOnHiNibble);
-            int minutes = toInt_2(buf, start + 4, startOnHiNibble);
-            
-            // Basic bounds checking
-            if (month < 1 || month > 12 || days < 1 || days > 31 || 
-                hours < 0 || hours > 23 || minutes < 0 || minutes > 59) {
-                Serial.print("ToDateTime: bad date conversion for ");
-                Serial.println(label);
-                return 0; // Invalid timestamp
-            }
-            
-            // Convert to Unix timestamp (simplified, not accounting for all edge cases)
-            struct tm timeinfo = { 0 };
-            timeinfo.tm_year = year - 1900;
-            timeinfo.tm_mon = month - 1;
-            timeinfo.tm_mday = days;
-            timeinfo.tm_hour = hours;
-            timeinfo.tm_min = minutes;
-            timeinfo.tm_sec = 0;
-            
-            time_t timestamp = mktime(&timeinfo);
-            return (uint32_t)timestamp;
-        }
-    }
-    
-    // DateTime conversion - 8 nibbles
-    static uint32_t toDateTime8(uint8_t* buf, int start, bool startOnHiNibble, const char* label) {
-        if (isErr8(buf, start + 0, startOnHiNibble)) {
-            Serial.print("ToDateTime: ");
-            Serial.print(label);
-            Serial.println(": no valid date");
-            return 0; // Invalid timestamp
-        }
-        else {
-            int year, month, days, tim1, tim2, tim3;
-            
-            if (startOnHiNibble) {
-                year = toInt_2(buf, start + 0, 1) + 2000;
-                month = toInt_1(buf, start + 1, 1);
-                days = toInt_2(buf, start + 1, 0);
-                tim1 = toInt_1(buf, start + 2, 0);
-                tim2 = toInt_1(buf, start + 3, 1);
-                tim3 = toInt_1(buf, start + 3, 0);
-            }
-            else {
-                year = toInt_2(buf, start + 0, 0) + 2000;
-                month = toInt_1(buf, start + 1, 0);
-                days = toInt_2(buf, start + 2, 1);
-                tim1 = toInt_1(buf, start + 3, 1);
-                tim2 = toInt_1(buf, start + 3, 0);
-                tim3 = toInt_1(buf, start + 4, 1);
-            }
-            
-            int hours, minutes;
-            if (tim1 >= 10) {
-                hours = tim1 + 10;
-            }
-            else {
-                hours = tim1;
-            }
-            
-            if (tim2 >= 10) {
-                hours += 10;
-                minutes = (tim2 - 10) * 10;
-            }
-            else {
-                minutes = tim2 * 10;
-            }
-            minutes += tim3;
-            
-            // Basic bounds checking
-            if (month < 1 || month > 12 || days < 1 || days > 31 || 
-                hours < 0 || hours > 23 || minutes < 0 || minutes > 59) {
-                Serial.print("ToDateTime: bad date conversion for ");
-                Serial.println(label);
-                return 0; // Invalid timestamp
-            }
-            
-            // Convert to Unix timestamp (simplified, not accounting for all edge cases)
-            struct tm timeinfo = { 0 };
-            timeinfo.tm_year = year - 1900;
-            timeinfo.tm_mon = month - 1;
-            timeinfo.tm_mday = days;
-            timeinfo.tm_hour = hours;
-            timeinfo.tm_min = minutes;
-            timeinfo.tm_sec = 0;
-            
-            time_t timestamp = mktime(&timeinfo);
-            return (uint32_t)timestamp;
-        }
-    }
-    
-    // Helper functions
-    static bool isOFL2(uint8_t* buf, int start, bool startOnHiNibble) {
-        if (startOnHiNibble) {
-            return ((buf[start + 0] >> 4) == 15 || (buf[start + 0] & 0xF) == 15);
-        }
-        else {
-            return ((buf[start + 0] & 0xF) == 15 || (buf[start + 1] >> 4) == 15);
-        }
-    }
-    
-    static bool isOFL3(uint8_t* buf, int start, bool startOnHiNibble) {
-        if (startOnHiNibble) {
-            return ((buf[start + 0] >> 4) == 15 || 
-                   (buf[start + 0] & 0xF) == 15 || 
-                   (buf[start + 1] >> 4) == 15);
-        }
-        else {
-            return ((buf[start + 0] & 0xF) == 15 || 
-                   (buf[start + 1] >> 4) == 15 || 
-                   (buf[start + 1] & 0xF) == 15);
-        }
-    }
-    
-    static bool isErr2(uint8_t* buf, int start, bool startOnHiNibble) {
-        if (startOnHiNibble) {
-            return ((buf[start + 0] >> 4) >= 10 && (buf[start + 0] >> 4) != 15 || 
-                   (buf[start + 0] & 0xF) >= 10 && (buf[start + 0] & 0xF) != 15);
-        }
-        else {
-            return ((buf[start + 0] & 0xF) >= 10 && (buf[start + 0] & 0xF) != 15 || 
-                   (buf[start + 1] >> 4) >= 10 && (buf[start + 1] >> 4) != 15);
-        }
-    }
-    
-    static bool isErr3(uint8_t* buf, int start, bool startOnHiNibble) {
-        if (startOnHiNibble) {
-            return ((buf[start + 0] >> 4) >= 10 && (buf[start + 0] >> 4) != 15 || 
-                   (buf[start + 0] & 0xF) >= 10 && (buf[start + 0] & 0xF) != 15 || 
-                   (buf[start + 1] >> 4) >= 10 && (buf[start + 1] >> 4) != 15);
-        }
-        else {
-            return ((buf[start + 0] & 0xF) >= 10 && (buf[start + 0] & 0xF) != 15 || 
-                   (buf[start + 1] >> 4) >= 10 && (buf[start + 1] >> 4) != 15 || 
-                   (buf[start + 1] & 0xF) >= 10 && (buf[start + 1] & 0xF) != 15);
-        }
-    }
-    
-    static bool isErr8(uint8_t* buf, int start, bool startOnHiNibble) {
-        if (startOnHiNibble) {
-            return ((buf[start + 0] >> 4) == 10 && 
-                   (buf[start + 0] & 0xF) == 10 && 
-                   (buf[start + 1] >> 4) == 4  && 
-                   (buf[start + 1] & 0xF) == 10 && 
-                   (buf[start + 2] >> 4) == 10 && 
-                   (buf[start + 2] & 0xF) == 4  && 
-                   (buf[start + 3] >> 4) == 10 && 
-                   (buf[start + 3] & 0xF) == 10);
-        }
-        else {
-            return ((buf[start + 0] & 0xF) == 10 && 
-                   (buf[start + 1] >> 4) == 10 && 
-                   (buf[start + 1] & 0xF) == 4  && 
-                   (buf[start + 2] >> 4) == 10 && 
-                   (buf[start + 2] & 0xF) == 10 && 
-                   (buf[start + 3] >> 4) == 4  && 
-                   (buf[start + 3] & 0xF) == 10 && 
-                   (buf[start + 4] >> 4) == 10);
-        }
-    }
-    
-    static uint8_t toInt_1(uint8_t* buf, int start, bool startOnHiNibble) {
-        if (startOnHiNibble) {
-            return (buf[start] >> 4);
-        }
-        else {
-            return (buf[start] & 0xF);
-        }
-    }
-    
-    static uint8_t toInt_2(uint8_t* buf, int start, bool startOnHiNibble) {
-        if (startOnHiNibble) {
-            return (buf[start] >> 4) * 10 + (buf[start + 0] & 0xF) * 1;
-        }
-        else {
-            return (buf[start] & 0xF) * 10 + (buf[start + 1] >> 4) * 1;
-        }
+    // Convert a station date/time to a Unix timestamp. The station clock has no
+    // time zone, so it is taken as UTC, which is also what mktime() did on the
+    // ESP32. Pure arithmetic instead of mktime() keeps this lock-free for parallel
+    // decoding on the host.
+    static uint32_t toUnixTime(int year, int month, int days, int hours, int minutes) {
+        // Days since 1970-01-01 (civil-from-days, March-based years)
+        int y = year - (month <= 2);
+        int era = y / 400;
+        int yearOfEra = y - era * 400;
+        int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + days - 1;
+        int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        int32_t daysSinceEpoch = era * 146097 + dayOfEra - 719468;
+        return (uint32_t)daysSinceEpoch * 86400 + hours * 3600 + minutes * 60;
     }
 };
 
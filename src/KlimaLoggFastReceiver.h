@@ -0,0 +1,195 @@
+// KlimaLoggFastReceiver.h
+#ifndef KLIMALOGG_FAST_RECEIVER_H
+#define KLIMALOGG_FAST_RECEIVER_H
+
+#if defined(ARDUINO) && defined(ESP32)
+
+#include <Arduino.h>
+#include <atomic>
+#include "KlimaLoggPulseDecoder.h"
+#include "SnapshotPublisher.h"
+
+#ifndef FAST_PATH_EDGE_RING
+#define FAST_PATH_EDGE_RING 2048   // Edges, must be a power of two (about two frames)
+#endif
+
+#ifndef FAST_PATH_MAX_PULSES
+#define FAST_PATH_MAX_PULSES 1200  // Pulse/gap pairs per train (a frame needs ~1000)
+#endif
+
+// KlimaLogg-only receive path. Times the edges on the radio data pin itself and
+// feeds complete pulse trains to KlimaLoggPulseDecoder, whose prefilter drops other
+// devices' trains before any decoding, instead of letting rtl_433_ESP run every
+// train through its whole decoder list. The radio is still set up by rtl_433_ESP;
+// this only takes over the data pin interrupt.
+//
+// The frame handler runs on the decode task while the ISR keeps filling the ring,
+// so it must return within a frame time or so: publish results, never wait.
+//
+// The ISR and the decode task share the ring indexes and the last edge time; the
+// counters are read from other tasks. All of those are atomics, and the decoder's
+// own counters are published as a snapshot after each train.
+class KlimaLoggFastReceiver {
+public:
+    struct Stats {
+        uint32_t trains;
+        uint32_t rejected;
+        uint32_t frames;
+        uint32_t noBuffer;      // Frames lost to an empty frame pool
+        uint32_t overflows;     // Edges lost to a full ring or over-long trains
+        uint32_t busyUs;        // Time spent in prefilter and decoder
+    };
+
+private:
+    static const uint32_t MASK = FAST_PATH_EDGE_RING - 1;
+    static_assert((FAST_PATH_EDGE_RING & MASK) == 0, "FAST_PATH_EDGE_RING must be a power of two");
+
+    // Edge durations with the level that ended in bit 15 (1 = mark)
+    uint16_t edges[FAST_PATH_EDGE_RING];
+    std::atomic<uint32_t> head;           // Written by the ISR
+    std::atomic<uint32_t> tail;           // Written by the decode task
+    std::atomic<uint32_t> lostEdges;
+    std::atomic<uint32_t> lastEdgeUs;     // Written by the ISR, read by the task
+    int pin;
+
+    // Train being assembled by the task
+    uint16_t pulses[FAST_PATH_MAX_PULSES];
+    uint16_t gaps[FAST_PATH_MAX_PULSES];
+    size_t count;
+    bool inPulse;
+
+    KlimaLoggPulseDecoder decoder;
+    SnapshotPublisher<KlimaLoggPulseDecoder::Stats> decoderStats;
+    std::atomic<uint32_t> busyUs;
+    std::atomic<uint32_t> trainOverflows;
+
+    // Gaps longer than this end a train
+    uint16_t resetUs() const {
+        return (uint16_t)(decoder.getConfig().bitUs * decoder.getConfig().maxRunBits * 2);
+    }
+
+    static inline KlimaLoggFastReceiver* instance = nullptr;
+
+    static void IRAM_ATTR onEdge() {
+        KlimaLoggFastReceiver* self = instance;
+        uint32_t now = micros();
+        uint32_t duration = now - self->lastEdgeUs.load(std::memory_order_relaxed);
+        // Stored before head, so a task that sees no new edge sees no newer time either
+        self->lastEdgeUs.store(now, std::memory_order_relaxed);
+        // The pin has just left the level that lasted for duration
+        uint16_t level = digitalRead(self->pin) ? 0 : 0x8000;
+        uint16_t entry = level | (duration > 0x7FFF ? 0x7FFF : duration);
+
+        uint32_t h = self->head.load(std::memory_order_relaxed);
+        // Acquire: the task has finished reading every slot below tail
+        if (h - self->tail.load(std::memory_order_acquire) >= FAST_PATH_EDGE_RING) {
+            self->lostEdges.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        self->edges[h & MASK] = entry;
+        self->head.store(h + 1, std::memory_order_release);
+    }
+
+    void finishTrain() {
+        if (count > 0) {
+            uint32_t start = micros();
+            decoder.process(pulses, gaps, count, -999); // No RSSI on this path
+            busyUs.fetch_add(micros() - start, std::memory_order_relaxed);
+            decoderStats.publish(decoder.getStats());
+        }
+        count = 0;
+        inPulse = false;
+    }
+
+    void addEdge(uint16_t entry) {
+        bool mark = entry & 0x8000;
+        uint16_t duration = entry & 0x7FFF;
+
+        if (!mark && duration >= resetUs()) {
+            // Long space: close the train, its last gap being the silence
+            if (inPulse) {
+                gaps[count++] = duration;
+            }
+            finishTrain();
+            return;
+        }
+        if (mark) {
+            if (count >= FAST_PATH_MAX_PULSES) {
+                trainOverflows.fetch_add(1, std::memory_order_relaxed);
+                count = 0;
+            }
+            pulses[count] = duration;
+            inPulse = true;
+        } else if (inPulse) {
+            gaps[count++] = duration;
+            inPulse = false;
+        }
+    }
+
+    void poll() {
+        uint32_t h = head.load(std::memory_order_acquire);
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (h == t) {
+            // No edges for a while: the train ended without a trailing space edge.
+            // Read the edge time after head and before the clock, so an edge that
+            // arrived meanwhile makes the silence look short, never long.
+            uint32_t last = lastEdgeUs.load(std::memory_order_relaxed);
+            if ((count > 0 || inPulse) && micros() - last > resetUs()) {
+                if (inPulse) {
+                    gaps[count++] = resetUs();
+                }
+                finishTrain();
+            }
+            return;
+        }
+        while (t != h) {
+            addEdge(edges[t & MASK]);
+            // Release: the ISR may reuse the slot once it sees the new tail
+            tail.store(++t, std::memory_order_release);
+        }
+    }
+
+public:
+    KlimaLoggFastReceiver(FramePool& pool, KlimaLoggPulseDecoder::FrameHandler handler) :
+        head(0), tail(0), lostEdges(0), lastEdgeUs(0), pin(-1),
+        count(0), inPulse(false),
+        decoder(pool, handler), busyUs(0), trainOverflows(0) {}
+
+    // Take over the data pin and start the decode task
+    void begin(int dataPin, UBaseType_t priority = 2) {
+        instance = this;
+        pin = dataPin;
+        lastEdgeUs.store(micros(), std::memory_order_relaxed);
+        detachInterrupt(digitalPinToInterrupt(pin));
+        pinMode(pin, INPUT);
+        attachInterrupt(digitalPinToInterrupt(pin), onEdge, CHANGE);
+
+        xTaskCreatePinnedToCore([](void* self) {
+            for (;;) {
+                ((KlimaLoggFastReceiver*)self)->poll();
+                vTaskDelay(1);
+            }
+        }, "klimaloggFast", 6144, this, priority, nullptr, 1);
+    }
+
+    // Counters for periodic logging, safe to read from any task
+    Stats getStats() const {
+        KlimaLoggPulseDecoder::Stats d;
+        if (!decoderStats.read(d)) {
+            memset(&d, 0, sizeof(d));
+        }
+        Stats s;
+        s.trains = d.trains;
+        s.rejected = d.rejected;
+        s.frames = d.frames;
+        s.noBuffer = d.noBuffer;
+        s.overflows = lostEdges.load(std::memory_order_relaxed) +
+                      trainOverflows.load(std::memory_order_relaxed);
+        s.busyUs = busyUs.load(std::memory_order_relaxed);
+        return s;
+    }
+};
+
+#endif // ARDUINO && ESP32
+
+#endif // KLIMALOGG_FAST_RECEIVER_H
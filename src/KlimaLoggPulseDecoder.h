@@ -0,0 +1,223 @@
+// KlimaLoggPulseDecoder.h
+#ifndef KLIMALOGG_PULSE_DECODER_H
+#define KLIMALOGG_PULSE_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+#include "FramePool.h"
+
+// Dedicated decoder for KlimaLogg FSK pulse trains, used instead of running every
+// train through the full rtl_433 decoder set.
+//
+// A pulse train is a list of (pulse, gap) durations in microseconds, as measured on
+// the receiver data pin: pulse = time on the mark frequency, gap = time on the space
+// frequency. The decoder slices it into bits at the KlimaLogg bit rate and undoes
+// the AX5051 line coding (ENCODING register 0x07: inverted, differential, scrambled;
+// FRAMING register: HDLC), giving the frame bytes between two HDLC flags.
+//
+// prefilter() looks only at the train length and the first pulse widths, so the
+// trains of other devices on the band are dropped for a few dozen operations.
+//
+// Frame bytes are written straight into a FramePool buffer, taken when a frame's
+// first byte arrives, and the handler gets that buffer; nothing is copied.
+class KlimaLoggPulseDecoder {
+public:
+    struct Config {
+        float bitUs;              // Bit period (17.241 kbit/s)
+        float tolerance;          // Allowed deviation from a whole number of bits, in bits
+        uint16_t minPulses;       // Shorter trains cannot hold a frame
+        uint8_t prefilterPulses;  // Pulse/gap widths checked by the prefilter
+        uint8_t maxRunBits;       // Longest plausible run of equal bits
+        bool invert;              // AX5051 ENCODING bit 0
+        bool differential;        // AX5051 ENCODING bit 1
+        bool scrambled;           // AX5051 ENCODING bit 2
+        Config() :
+            bitUs(58.0f), tolerance(0.3f), minPulses(200), prefilterPulses(24),
+            maxRunBits(24), invert(true), differential(true), scrambled(true) {}
+    };
+
+    struct Stats {
+        uint32_t trains;      // Pulse trains offered
+        uint32_t rejected;    // Dropped by the prefilter
+        uint32_t decoded;     // Passed the prefilter and fully decoded
+        uint32_t frames;      // Frames handed to the handler
+        uint32_t noBuffer;    // Frames lost because the pool was empty
+    };
+
+    // Gets the frame with its length and RSSI set
+    typedef void (*FrameHandler)(FrameHandle frame);
+
+    static const size_t MAX_FRAME = FRAME_POOL_FRAME_SIZE;
+    static const uint8_t HDLC_FLAG = 0x7E;
+
+private:
+    Config config;
+    Stats stats;
+    FramePool& pool;
+    FrameHandler handler;
+
+    // Width in whole bits, or 0 if it is not close to a whole number of bits
+    uint16_t toBits(uint16_t widthUs) const {
+        float bits = widthUs / config.bitUs;
+        uint16_t whole = (uint16_t)(bits + 0.5f);
+        float error = bits - whole;
+        if (whole == 0 || error > config.tolerance || error < -config.tolerance) {
+            return 0;
+        }
+        return whole;
+    }
+
+    // Line decoder state, fed one received bit at a time
+    struct LineState {
+        uint8_t previous;     // Previous channel bit (differential)
+        uint32_t history;     // Last 17 line bits (descrambler)
+        uint8_t ones;         // Consecutive ones (HDLC destuffing)
+        uint8_t flagShift;    // Last 8 decoded bits, looking for flags
+        bool inFrame;
+        uint8_t current;      // Byte being assembled, LSB first
+        uint8_t bitCount;
+        size_t length;
+    };
+
+    // Returns true when a complete frame ended at this bit
+    bool pushBit(LineState& s, uint8_t channelBit, FrameHandle& frame) {
+        uint8_t bit = channelBit ^ (config.invert ? 1 : 0);
+        if (config.differential) {
+            // No transition is a one, a transition a zero
+            uint8_t diff = !(bit ^ s.previous);
+            s.previous = bit;
+            bit = diff;
+        }
+        if (config.scrambled) {
+            // Self-synchronising descrambler, 1 + x^12 + x^17
+            uint8_t out = bit ^ ((s.history >> 11) & 1) ^ ((s.history >> 16) & 1);
+            s.history = (s.history << 1) | bit;
+            bit = out;
+        }
+
+        s.flagShift = (s.flagShift >> 1) | (bit << 7);
+        if (s.flagShift == HDLC_FLAG) {
+            bool complete = s.inFrame && s.length > 0;
+            // A flag closes the current frame and opens the next one
+            s.inFrame = true;
+            s.ones = 0;
+            s.bitCount = 0;
+            s.current = 0;
+            if (complete) {
+                return true;
+            }
+            s.length = 0;
+            return false;
+        }
+        if (!s.inFrame) {
+            return false;
+        }
+
+        if (bit) {
+            if (++s.ones > 6) {
+                // Abort sequence, wait for the next flag
+                s.inFrame = false;
+                s.length = 0;
+                return false;
+            }
+        } else {
+            if (s.ones == 5) {
+                // Stuffed zero
+                s.ones = 0;
+                return false;
+            }
+            s.ones = 0;
+        }
+
+        s.current |= bit << s.bitCount;
+        if (++s.bitCount == 8) {
+            if (s.length == 0 && !frame) {
+                frame = pool.acquire();
+            }
+            if (s.length < MAX_FRAME) {
+                if (frame) {
+                    frame.data()[s.length] = s.current;
+                }
+                s.length++;
+            }
+            s.current = 0;
+            s.bitCount = 0;
+        }
+        return false;
+    }
+
+public:
+    KlimaLoggPulseDecoder(FramePool& _pool, FrameHandler _handler = nullptr,
+                          const Config& _config = Config()) :
+        config(_config), pool(_pool), handler(_handler) {
+        memset(&stats, 0, sizeof(stats));
+    }
+
+    // Cheap check on length and the first pulse widths
+    bool prefilter(const uint16_t* pulse, const uint16_t* gap, size_t count) const {
+        if (count < config.minPulses) {
+            return false;
+        }
+        size_t check = count < config.prefilterPulses ? count : config.prefilterPulses;
+        for (size_t i = 0; i < check; i++) {
+            uint16_t p = toBits(pulse[i]);
+            uint16_t g = toBits(gap[i]);
+            if (!p || !g || p > config.maxRunBits || g > config.maxRunBits) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Slice and decode the whole train, calling the handler for each frame.
+    // Returns the number of frames found.
+    int decode(const uint16_t* pulse, const uint16_t* gap, size_t count, int rssi) {
+        stats.decoded++;
+        FrameHandle frame;    // Reused across aborted frames, handed on with complete ones
+        LineState state;
+        memset(&state, 0, sizeof(state));
+        int frames = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            // The final gap is the end of the transmission, not data
+            uint16_t runs[2] = { toBits(pulse[i]), i + 1 < count ? toBits(gap[i]) : (uint16_t)0 };
+            for (int level = 0; level < 2; level++) {
+                uint8_t channelBit = level == 0 ? 1 : 0;
+                for (uint16_t b = 0; b < runs[level]; b++) {
+                    if (pushBit(state, channelBit, frame)) {
+                        if (!frame) {
+                            stats.noBuffer++;
+                        } else {
+                            frames++;
+                            stats.frames++;
+                            if (handler) {
+                                frame.setLength(state.length);
+                                frame.setRssi(rssi);
+                                handler(std::move(frame));
+                            }
+                        }
+                        state.length = 0;
+                    }
+                }
+            }
+        }
+        return frames;
+    }
+
+    // Prefilter, then decode only trains that pass
+    int process(const uint16_t* pulse, const uint16_t* gap, size_t count, int rssi) {
+        stats.trains++;
+        if (!prefilter(pulse, gap, count)) {
+            stats.rejected++;
+            return 0;
+        }
+        return decode(pulse, gap, count, rssi);
+    }
+
+    const Stats& getStats() const { return stats; }
+    const Config& getConfig() const { return config; }
+};
+
+#endif // KLIMALOGG_PULSE_DECODER_H
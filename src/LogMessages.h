@@ -0,0 +1,26 @@
+// LogMessages.h
+#ifndef LOG_MESSAGES_H
+#define LOG_MESSAGES_H
+
+// Messages written through DeferredLog. Call sites only store the message id and
+// the raw arguments; the format string is applied later by the drain task or by
+// tools/log_decode on the host, which must be built from the same revision.
+//
+// Format specifiers: %d %u %x %X (32-bit integers), %f (float), %s (copied string),
+// %H (LogBytes, printed as hex), %% (literal percent sign).
+//
+//   X(id, level, format)
+#define KLIMALOGG_LOG_MESSAGES(X) \
+    X(RX_CANDIDATE,     LOG_LEVEL_TRACE,   "Potential KlimaLogg data, RSSI: %d, Length: %u bytes") \
+    X(RX_DATA,          LOG_LEVEL_TRACE,   "Data: %H...") \
+    X(RX_VALID,         LOG_LEVEL_NOTICE,  "Valid KlimaLogg data received!") \
+    X(RX_JSON_ERROR,    LOG_LEVEL_ERROR,   "deserializeJson() failed: %s") \
+    X(RX_RECOGNIZED,    LOG_LEVEL_NOTICE,  "KlimaLogg data recognized by rtl_433!") \
+    X(LOG_OVERRUN,      LOG_LEVEL_WARNING, "Deferred log overrun, %u messages dropped") \
+    X(RX_NO_BUFFER,     LOG_LEVEL_WARNING, "No free frame buffer, frame dropped") \
+    X(RX_TOO_LONG,      LOG_LEVEL_WARNING, "Frame of %u bytes too long, dropped") \
+    X(RX_TOO_SHORT,     LOG_LEVEL_WARNING, "Current weather frame too short (%u bytes)") \
+    X(TS_NOT_SET,       LOG_LEVEL_TRACE,   "ToDateTime: %s: no valid date") \
+    X(TS_BAD_DATE,      LOG_LEVEL_WARNING, "ToDateTime: bad date conversion for %s")
+
+#endif // LOG_MESSAGES_H
@@ -0,0 +1,340 @@
+// MqttTransport.h
+#ifndef MQTT_TRANSPORT_H
+#define MQTT_TRANSPORT_H
+
+#include <Arduino.h>
+#include <Client.h>
+#include "PublishTransport.h"
+
+// Minimal MQTT 3.1.1 client (CONNECT, QoS 1 PUBLISH, PINGREQ) on top of any Arduino Client.
+// Works with WiFiClient on the board and with a socket based Client on the host.
+// connect() blocks for the TCP connect and up to connackTimeoutMs for the broker, so
+// call it from a task that may stall (see publisherTask in main).
+//
+// One message is in flight at a time: lastDelivery() stays PENDING until the broker's
+// PUBACK arrives. A PUBACK or PINGRESP that does not arrive within responseTimeoutMs
+// means the link is half-open (writes still succeed, nothing gets through), so the
+// session is dropped and the pending message reported FAILED.
+class MqttTransport : public PublishTransport {
+private:
+    Client& client;
+    const char* host;
+    uint16_t port;
+    const char* clientId;
+    const char* topic;
+    const char* username;
+    const char* password;
+    uint16_t keepAliveSeconds;
+    unsigned long lastOutbound;
+    bool sessionOpen;
+    unsigned long connackTimeoutMs;
+    unsigned long responseTimeoutMs;
+    bool (*networkReady)();
+    unsigned long (*clock)();
+
+    // Acknowledgement and keep-alive state
+    uint16_t nextPacketId;
+    uint16_t pendingPacketId;
+    unsigned long publishedAt;
+    Delivery delivery;
+    bool pingPending;
+    unsigned long pingSentAt;
+    uint32_t responseTimeouts;
+
+    // Incoming packet parser, fed one byte at a time from loop()
+    enum InState { IN_TYPE, IN_LENGTH, IN_BODY };
+    InState inState;
+    uint8_t inType;
+    size_t inRemaining;
+    uint8_t inShift;
+    size_t inPos;
+    uint8_t inBody[2];    // Only the packet id of PUBACK is needed
+
+    // Packet types (upper nibble of the fixed header)
+    static const uint8_t CONNECT  = 0x10;
+    static const uint8_t CONNACK  = 0x20;
+    static const uint8_t PUBLISH  = 0x30;
+    static const uint8_t PUBACK   = 0x40;
+    static const uint8_t PINGREQ  = 0xC0;
+    static const uint8_t PINGRESP = 0xD0;
+    static const uint8_t DISCONNECT = 0xE0;
+
+    static const uint8_t QOS_1 = 0x02;
+
+    static const unsigned long DEFAULT_CONNACK_TIMEOUT_MS = 1000;
+    static const unsigned long DEFAULT_RESPONSE_TIMEOUT_MS = 5000;
+
+    // Write fixed header: packet type plus variable-length "remaining length"
+    size_t writeHeader(uint8_t type, size_t remaining) {
+        uint8_t header[5];
+        size_t pos = 0;
+        header[pos++] = type;
+        do {
+            uint8_t digit = remaining % 128;
+            remaining /= 128;
+            if (remaining > 0) {
+                digit |= 0x80;
+            }
+            header[pos++] = digit;
+        } while (remaining > 0 && pos < sizeof(header));
+        return client.write(header, pos);
+    }
+
+    size_t writeString(const char* value) {
+        uint16_t len = strlen(value);
+        uint8_t prefix[2] = { (uint8_t)(len >> 8), (uint8_t)(len & 0xFF) };
+        return client.write(prefix, 2) + client.write((const uint8_t*)value, len);
+    }
+
+    bool waitForConnack() {
+        unsigned long start = millis();
+        uint8_t response[4];
+        size_t received = 0;
+        while (received < sizeof(response)) {
+            if (!client.connected() || millis() - start > connackTimeoutMs) {
+                return false;
+            }
+            if (client.available()) {
+                response[received++] = client.read();
+            } else {
+                delay(1);
+            }
+        }
+        // Return code 0 means connection accepted
+        return response[0] == CONNACK && response[3] == 0;
+    }
+
+    // Close the stream; a message still waiting for its PUBACK has to be sent again
+    void dropSession() {
+        client.stop();
+        sessionOpen = false;
+        pingPending = false;
+        pendingPacketId = 0;
+        if (delivery == PENDING) {
+            delivery = FAILED;
+        }
+    }
+
+    void handlePacket() {
+        switch (inType & 0xF0) {
+            case PUBACK:
+                if (inPos >= 2 && pendingPacketId == ((inBody[0] << 8) | inBody[1])) {
+                    pendingPacketId = 0;
+                    delivery = DELIVERED;
+                }
+                break;
+            case PINGRESP:
+                pingPending = false;
+                break;
+        }
+    }
+
+    void receiveByte(uint8_t value) {
+        switch (inState) {
+            case IN_TYPE:
+                inType = value;
+                inRemaining = 0;
+                inShift = 0;
+                inPos = 0;
+                inState = IN_LENGTH;
+                break;
+            case IN_LENGTH:
+                inRemaining |= (size_t)(value & 0x7F) << inShift;
+                inShift += 7;
+                if (!(value & 0x80)) {
+                    if (inRemaining == 0) {
+                        handlePacket();
+                        inState = IN_TYPE;
+                    } else {
+                        inState = IN_BODY;
+                    }
+                }
+                break;
+            case IN_BODY:
+                if (inPos < sizeof(inBody)) {
+                    inBody[inPos] = value;
+                }
+                if (++inPos == inRemaining) {
+                    handlePacket();
+                    inState = IN_TYPE;
+                }
+                break;
+        }
+    }
+
+public:
+    MqttTransport(Client& _client, const char* _host, uint16_t _port,
+                  const char* _clientId, const char* _topic,
+                  const char* _username = nullptr, const char* _password = nullptr,
+                  uint16_t _keepAliveSeconds = 30) :
+        client(_client),
+        host(_host),
+        port(_port),
+        clientId(_clientId),
+        topic(_topic),
+        username(_username),
+        password(_password),
+        keepAliveSeconds(_keepAliveSeconds),
+        lastOutbound(0),
+        sessionOpen(false),
+        connackTimeoutMs(DEFAULT_CONNACK_TIMEOUT_MS),
+        responseTimeoutMs(DEFAULT_RESPONSE_TIMEOUT_MS),
+        networkReady(nullptr),
+        clock(millis),
+        nextPacketId(1),
+        pendingPacketId(0),
+        publishedAt(0),
+        delivery(DELIVERED),
+        pingPending(false),
+        pingSentAt(0),
+        responseTimeouts(0),
+        inState(IN_TYPE)
+    {
+    }
+
+    // Skip connection attempts while ready() returns false (e.g. WiFi not associated)
+    void setNetworkCheck(bool (*ready)()) {
+        networkReady = ready;
+    }
+
+    void setConnackTimeout(unsigned long timeoutMs) {
+        connackTimeoutMs = timeoutMs;
+    }
+
+    // How long PUBACK and PINGRESP may take before the session is dropped
+    void setResponseTimeout(unsigned long timeoutMs) {
+        responseTimeoutMs = timeoutMs;
+    }
+
+    // Time source for the keep-alive and response deadlines, so the transport can
+    // run on a virtual clock (the CONNACK wait always blocks in real time)
+    void setClock(unsigned long (*_clock)()) {
+        clock = _clock;
+    }
+
+    bool connect() override {
+        dropSession();
+        if (networkReady && !networkReady()) {
+            return false;
+        }
+        if (!client.connect(host, port)) {
+            return false;
+        }
+
+        // Variable header: protocol name, level 4, flags, keep-alive
+        uint8_t flags = 0x02; // Clean session
+        size_t remaining = 10 + 2 + strlen(clientId);
+        if (username) {
+            flags |= 0x80;
+            remaining += 2 + strlen(username);
+        }
+        if (password) {
+            flags |= 0x40;
+            remaining += 2 + strlen(password);
+        }
+        const uint8_t variableHeader[10] = {
+            0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, flags,
+            (uint8_t)(keepAliveSeconds >> 8), (uint8_t)(keepAliveSeconds & 0xFF)
+        };
+
+        writeHeader(CONNECT, remaining);
+        client.write(variableHeader, sizeof(variableHeader));
+        writeString(clientId);
+        if (username) writeString(username);
+        if (password) writeString(password);
+
+        if (!waitForConnack()) {
+            client.stop();
+            return false;
+        }
+        inState = IN_TYPE;
+        lastOutbound = clock();
+        sessionOpen = true;
+        return true;
+    }
+
+    bool connected() override {
+        if (sessionOpen && !client.connected()) {
+            dropSession();
+        }
+        return sessionOpen;
+    }
+
+    bool publish(const uint8_t* payload, size_t length) override {
+        if (!connected() || delivery == PENDING) {
+            return false;
+        }
+        size_t topicLength = strlen(topic);
+        size_t remaining = 2 + topicLength + 2 + length;
+        size_t expected = (remaining < 128 ? 2 : remaining < 16384 ? 3 : 4) + remaining;
+
+        uint16_t packetId = nextPacketId;
+        nextPacketId = nextPacketId == 0xFFFF ? 1 : nextPacketId + 1;
+        const uint8_t id[2] = { (uint8_t)(packetId >> 8), (uint8_t)(packetId & 0xFF) };
+
+        size_t written = writeHeader(PUBLISH | QOS_1, remaining);
+        written += writeString(topic);
+        written += client.write(id, sizeof(id));
+        written += client.write(payload, length);
+        if (written != expected) {
+            // Partial write leaves the stream unusable, start over on the next connect
+            dropSession();
+            return false;
+        }
+        pendingPacketId = packetId;
+        delivery = PENDING;
+        publishedAt = clock();
+        lastOutbound = publishedAt;
+        return true;
+    }
+
+    Delivery lastDelivery() override {
+        return delivery;
+    }
+
+    // Whether a PUBACK or PINGRESP is outstanding
+    bool awaitingResponse() const {
+        return sessionOpen && (delivery == PENDING || pingPending);
+    }
+
+    // Sessions dropped because the broker stopped answering
+    uint32_t getResponseTimeouts() const {
+        return responseTimeouts;
+    }
+
+    void loop() override {
+        if (!connected()) {
+            return;
+        }
+        while (client.available()) {
+            int value = client.read();
+            if (value < 0) {
+                break;
+            }
+            receiveByte((uint8_t)value);
+        }
+
+        unsigned long now = clock();
+        if ((delivery == PENDING && now - publishedAt >= responseTimeoutMs) ||
+            (pingPending && now - pingSentAt >= responseTimeoutMs)) {
+            responseTimeouts++;
+            dropSession();
+            return;
+        }
+        if (!pingPending && now - lastOutbound >= keepAliveSeconds * 1000UL / 2) {
+            writeHeader(PINGREQ, 0);
+            pingPending = true;
+            pingSentAt = now;
+            lastOutbound = now;
+        }
+    }
+
+    void disconnect() {
+        if (connected()) {
+            writeHeader(DISCONNECT, 0);
+        }
+        dropSession();
+    }
+};
+
+#endif // MQTT_TRANSPORT_H
@@ -0,0 +1,38 @@
+// PublishTransport.h
+#ifndef PUBLISH_TRANSPORT_H
+#define PUBLISH_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Interface for the link that batched readings are delivered over (MQTT, HTTP, ...)
+class PublishTransport {
+public:
+    virtual ~PublishTransport() {}
+
+    // (Re)establish the link; returns true once it is usable
+    virtual bool connect() = 0;
+
+    // Whether the link is currently usable
+    virtual bool connected() = 0;
+
+    // Outcome of the last publish()
+    enum Delivery {
+        DELIVERED,    // The receiver has the message
+        PENDING,      // Sent, waiting for the receiver to confirm it
+        FAILED        // The link dropped before the receiver confirmed it
+    };
+
+    // Deliver one message; returns false if it was not accepted and must be retried
+    virtual bool publish(const uint8_t* payload, size_t length) = 0;
+
+    // Transports that wait for a confirmation report PENDING until it arrives (in
+    // loop()), and refuse further messages until then. Keep a message until this
+    // says DELIVERED; on FAILED it has to be sent again.
+    virtual Delivery lastDelivery() { return DELIVERED; }
+
+    // Housekeeping such as keep-alives (call this in loop)
+    virtual void loop() {}
+};
+
+#endif // PUBLISH_TRANSPORT_H
@@ -0,0 +1,96 @@
+// ReceivePath.h
+#ifndef RECEIVE_PATH_H
+#define RECEIVE_PATH_H
+
+#include <stdint.h>
+#include "DeferredLog.h"
+#include "FrameParser.h"
+#include "FramePool.h"
+#include "FrameRecorder.h"
+#include "SnapshotPublisher.h"
+#include "StationTable.h"
+
+// Latest decoded KlimaLogg readings, published by the decode task
+struct KlimaLoggSnapshot {
+    KlimaLoggFrameParser::CurrentData data;
+    uint16_t deviceId;
+    int rssi;
+    unsigned long receivedAt;
+};
+
+// The steps from a received raw frame to published readings: log, record, validate,
+// parse and publish to the display snapshot and the per-station table, and the
+// publisher task's hand-over from that table to the batch publisher. The firmware
+// and tools/klimalogg_soak both run these, so the soak test measures the code that
+// ships. Times are passed in, so the soak test can run it on a virtual clock.
+class ReceivePath {
+private:
+    SnapshotPublisher<KlimaLoggSnapshot>& latest;
+    StationTable<KlimaLoggSnapshot>* stations;
+    FrameRecorder* recorder;
+
+public:
+    ReceivePath(SnapshotPublisher<KlimaLoggSnapshot>& _latest) :
+        latest(_latest), stations(nullptr), recorder(nullptr) {}
+
+    // Optional consumers; set them before the receivers start
+    void setStationTable(StationTable<KlimaLoggSnapshot>* _stations) { stations = _stations; }
+    void setRecorder(FrameRecorder* _recorder) { recorder = _recorder; }
+
+    // Hand valid readings to the display and the publisher (single writer: the decode task)
+    void publish(const KlimaLoggSnapshot& snapshot) {
+        latest.publish(snapshot);
+        if (stations) {
+            stations->publish(snapshot.deviceId, snapshot);
+        }
+    }
+
+    // Process one frame (single caller: the decode task). snapshot receives the
+    // parsed readings; returns true if they were valid and have been published.
+    bool process(const FrameHandle& frame, uint32_t timestamp, unsigned long receivedAt,
+                 KlimaLoggSnapshot& snapshot) {
+        const uint8_t* buffer = frame.data();
+        size_t length = frame.length();
+
+        // Debug print the raw data
+        DLOG(RX_CANDIDATE, frame.rssi(), length);
+        DLOG(RX_DATA, LogBytes(buffer, length < 32 ? length : 32));
+
+        if (recorder) {
+            recorder->add(frame, timestamp);
+        }
+
+        if (length < KlimaLoggFrameParser::CurrentWeatherSchema::LENGTH) {
+            return false;
+        }
+        snapshot.data = KlimaLoggFrameParser::parseCurrentWeatherFrame(buffer, length);
+        snapshot.data.timestamp = timestamp;
+        snapshot.deviceId = (buffer[0] << 8) | buffer[1];
+        snapshot.rssi = frame.rssi();
+        snapshot.receivedAt = receivedAt;
+        if (!KlimaLoggFrameParser::hasValidReadings(snapshot.data)) {
+            return false;
+        }
+        DLOG(RX_VALID);
+
+        // Display, serial output and the publisher task pick it up from here
+        publish(snapshot);
+        return true;
+    }
+
+    // Add the readings of every station updated since reader's last call to a
+    // BatchPublisher (single caller: the publisher task). Returns the number added.
+    template <typename Publisher>
+    size_t forward(StationTable<KlimaLoggSnapshot>::Reader& reader, Publisher& publisher,
+                   unsigned long now) {
+        if (!stations) {
+            return 0;
+        }
+        KlimaLoggSnapshot snapshot;
+        return stations->collect(reader, snapshot, [&](const KlimaLoggSnapshot& s) {
+            publisher.add(s.deviceId, s.data, s.rssi, s.data.timestamp, now);
+        });
+    }
+};
+
+#endif // RECEIVE_PATH_H
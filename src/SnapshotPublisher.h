@@ -0,0 +1,83 @@
+// SnapshotPublisher.h
+#ifndef SNAPSHOT_PUBLISHER_H
+#define SNAPSHOT_PUBLISHER_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+// Single-writer / many-reader publication of the latest value using a sequence lock.
+// The writer (the rtl_433 decode task) never waits for readers; readers (display,
+// serial output, network and storage tasks) copy the value out and retry if the
+// writer touched it while they were copying, so they never see a torn value.
+//
+// T must be trivially copyable: it is copied with memcpy on both sides.
+template <typename T>
+class SnapshotPublisher {
+private:
+    // Even while stable, odd while the writer is in the middle of an update
+    std::atomic<uint32_t> sequence;
+    T value;
+
+public:
+    // How often a reader retries before giving up on a busy writer
+    static const int DEFAULT_READ_ATTEMPTS = 8;
+
+    SnapshotPublisher() : sequence(0), value() {}
+
+    // Publish a new value (single writer only)
+    void publish(const T& newValue) {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(static_cast<void*>(&value), &newValue, sizeof(T));
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Number of values published so far; 0 means nothing has been published yet
+    uint32_t generation() const {
+        return sequence.load(std::memory_order_acquire) >> 1;
+    }
+
+    // Copy the latest value into out. Returns false if nothing has been published
+    // yet or if the writer kept updating for all attempts; out is then undefined.
+    bool read(T& out, uint32_t* generationOut = nullptr,
+              int attempts = DEFAULT_READ_ATTEMPTS) const {
+        for (int i = 0; i < attempts; i++) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before == 0) {
+                return false;
+            }
+            if (before & 1) {
+                continue;
+            }
+            memcpy(static_cast<void*>(&out), &value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint32_t after = sequence.load(std::memory_order_relaxed);
+            if (before == after) {
+                if (generationOut) {
+                    *generationOut = before >> 1;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Copy the latest value only if it is newer than lastGeneration, which is
+    // updated on success. Lets readers skip work when nothing changed.
+    bool readIfChanged(T& out, uint32_t& lastGeneration,
+                       int attempts = DEFAULT_READ_ATTEMPTS) const {
+        if (generation() == lastGeneration) {
+            return false;
+        }
+        uint32_t gen;
+        if (!read(out, &gen, attempts) || gen == lastGeneration) {
+            return false;
+        }
+        lastGeneration = gen;
+        return true;
+    }
+};
+
+#endif // SNAPSHOT_PUBLISHER_H
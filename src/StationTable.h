@@ -0,0 +1,89 @@
+// StationTable.h
+#ifndef STATION_TABLE_H
+#define STATION_TABLE_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include "SnapshotPublisher.h"
+
+#ifndef STATION_TABLE_SIZE
+#define STATION_TABLE_SIZE 16   // Stations tracked at once
+#endif
+
+// Latest value of every station, written by the decode task and collected by the
+// publisher task. Each station has its own slot with its own SnapshotPublisher, so
+// a reader that was blocked for a while (connecting, writing flash) still finds the
+// newest value of every station it missed; only older values of the same station
+// are replaced, as they would be within a batch window anyway. A station that finds
+// no free slot is counted and dropped. Slots are never given back.
+template <typename T>
+class StationTable {
+public:
+    // Position of one reader: the generation of each slot it has collected
+    struct Reader {
+        uint32_t generations[STATION_TABLE_SIZE];
+        Reader() { memset(generations, 0, sizeof(generations)); }
+    };
+
+private:
+    static const int32_t FREE = -1;
+
+    struct Slot {
+        std::atomic<int32_t> deviceId;
+        SnapshotPublisher<T> latest;
+        Slot() : deviceId(FREE) {}
+    };
+
+    Slot slots[STATION_TABLE_SIZE];
+    std::atomic<uint32_t> dropped;
+
+public:
+    StationTable() : dropped(0) {}
+
+    // Store the latest value of one station (single writer: the decode task)
+    bool publish(uint16_t deviceId, const T& value) {
+        for (size_t i = 0; i < STATION_TABLE_SIZE; i++) {
+            Slot& slot = slots[i];
+            int32_t id = slot.deviceId.load(std::memory_order_relaxed);
+            if (id == deviceId) {
+                slot.latest.publish(value);
+                return true;
+            }
+            if (id == FREE) {
+                // Fill the slot before readers can see whose it is
+                slot.latest.publish(value);
+                slot.deviceId.store(deviceId, std::memory_order_release);
+                return true;
+            }
+        }
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Call f(value) for every station updated since this reader's last call.
+    // Returns the number of stations collected.
+    template <typename F>
+    size_t collect(Reader& reader, T& value, F f) const {
+        size_t collected = 0;
+        for (size_t i = 0; i < STATION_TABLE_SIZE; i++) {
+            const Slot& slot = slots[i];
+            if (slot.deviceId.load(std::memory_order_acquire) == FREE) {
+                break;    // Slots are taken in order
+            }
+            // A slot the writer keeps busy is picked up on the next call
+            if (slot.latest.readIfChanged(value, reader.generations[i])) {
+                f(value);
+                collected++;
+            }
+        }
+        return collected;
+    }
+
+    // Values dropped because every slot belongs to another station
+    uint32_t getDropped() const {
+        return dropped.load(std::memory_order_relaxed);
+    }
+};
+
+#endif // STATION_TABLE_H
@@ -0,0 +1,160 @@
+// frame_pool_stress.cpp
+// Threaded stress test of FramePool: several threads acquire frames, fill them with
+// a pattern of their own, share() a reference to a neighbour thread and release
+// their handle, while the neighbour checks the pattern before releasing the last
+// reference. A buffer handed out twice, or returned while still referenced, shows
+// up as a changed pattern. At the end every slot must be free again. Reports the
+// cycle rate and exits non-zero on any inconsistency.
+//
+// Build:
+//   g++ -std=c++17 -O2 -pthread -Itools/host -Isrc tools/frame_pool_stress.cpp -o frame_pool_stress
+//
+// Examples:
+//   ./frame_pool_stress --threads 4 --seconds 5
+//   ./frame_pool_stress --threads 8 --hold 4
+
+#include <Arduino.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "FramePool.h"
+
+static FramePool pool;
+
+// Frames shared by one thread and checked and released by another
+struct Mailbox {
+    std::mutex lock;
+    std::deque<std::pair<FrameHandle, uint8_t>> frames;
+};
+
+struct ThreadResult {
+    uint64_t cycles = 0;
+    uint64_t exhausted = 0;
+    uint64_t corrupted = 0;
+};
+
+static bool filledWith(const FrameHandle& frame, uint8_t pattern) {
+    if (frame.length() != FrameHandle::capacity()) {
+        return false;
+    }
+    for (size_t i = 0; i < frame.length(); i++) {
+        if (frame.data()[i] != (uint8_t)(pattern + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int threadCount = 4;
+    double seconds = 5;
+    size_t hold = 2;            // Frames a mailbox keeps while the pool has free slots
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--threads" && more) threadCount = atoi(argv[++i]);
+        else if (a == "--seconds" && more) seconds = atof(argv[++i]);
+        else if (a == "--hold" && more) hold = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: frame_pool_stress [--threads N] [--seconds S] [--hold N]\n");
+            return 1;
+        }
+    }
+    if (threadCount < 2) {
+        threadCount = 2;
+    }
+
+    std::atomic<bool> running(true);
+    std::vector<Mailbox> mailboxes(threadCount);
+    std::vector<ThreadResult> results(threadCount);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            ThreadResult& result = results[t];
+            Mailbox& inbox = mailboxes[t];
+            Mailbox& neighbour = mailboxes[(t + 1) % threadCount];
+            for (uint32_t n = 0; running; n++) {
+                FrameHandle frame = pool.acquire();
+                bool starved = !frame;
+                if (frame) {
+                    uint8_t pattern = (uint8_t)(t * 37 + n);
+                    for (size_t i = 0; i < FrameHandle::capacity(); i++) {
+                        frame.data()[i] = (uint8_t)(pattern + i);
+                    }
+                    frame.setLength(FrameHandle::capacity());
+                    {
+                        std::lock_guard<std::mutex> guard(neighbour.lock);
+                        neighbour.frames.emplace_back(frame.share(), pattern);
+                    }
+                    // Our reference goes first; the neighbour's keeps the buffer alive
+                    if (!filledWith(frame, pattern)) {
+                        result.corrupted++;
+                    }
+                    frame.release();
+                    result.cycles++;
+                } else {
+                    // Let the threads holding frames run, as a waiting task would
+                    result.exhausted++;
+                    std::this_thread::yield();
+                }
+
+                // Check and release what the other thread shared with us; all of
+                // it when the pool ran dry, or the threads could hold every slot
+                std::deque<std::pair<FrameHandle, uint8_t>> received;
+                {
+                    std::lock_guard<std::mutex> guard(inbox.lock);
+                    while (inbox.frames.size() > (starved ? 0 : hold)) {
+                        received.push_back(std::move(inbox.frames.front()));
+                        inbox.frames.pop_front();
+                    }
+                }
+                for (auto& entry : received) {
+                    if (!filledWith(entry.first, entry.second)) {
+                        result.corrupted++;
+                    }
+                }
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    running = false;
+    for (std::thread& t : threads) t.join();
+
+    // Everything still in a mailbox is checked and released here
+    uint64_t cycles = 0, exhausted = 0, corrupted = 0;
+    for (int t = 0; t < threadCount; t++) {
+        for (auto& entry : mailboxes[t].frames) {
+            if (!filledWith(entry.first, entry.second)) {
+                results[t].corrupted++;
+            }
+        }
+        mailboxes[t].frames.clear();
+        const ThreadResult& result = results[t];
+        printf("thread %d: %.0f cycles/s, %llu exhausted, %llu corrupted\n", t,
+               result.cycles / seconds, (unsigned long long)result.exhausted,
+               (unsigned long long)result.corrupted);
+        cycles += result.cycles;
+        exhausted += result.exhausted;
+        corrupted += result.corrupted;
+    }
+
+    // Every slot must be free again: the pool hands out all of them once more
+    FramePool::Stats stats = pool.getStats();
+    std::vector<FrameHandle> all;
+    for (size_t i = 0; i < FramePool::size(); i++) {
+        all.push_back(pool.acquire());
+    }
+    size_t recovered = 0;
+    for (const FrameHandle& frame : all) recovered += frame.valid();
+
+    printf("total:    %.0f cycles/s, %llu exhausted, %llu corrupted\n", cycles / seconds,
+           (unsigned long long)exhausted, (unsigned long long)corrupted);
+    printf("pool:     %u acquired, %u in use at the end, high water %u of %zu, %zu/%zu free again\n",
+           stats.acquired, stats.inUse, stats.highWater, FramePool::size(), recovered, FramePool::size());
+    return corrupted || stats.inUse || recovered != FramePool::size() ? 2 : 0;
+}
@@ -0,0 +1,61 @@
+// Arduino.h (host)
+// Just enough of the Arduino core to build the header-only parts of src/ with a
+// normal C++ compiler on Linux, for the tools in tools/.
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#define HEX 16
+#define DEC 10
+
+using std::min;
+using std::max;
+
+inline unsigned long millis() {
+    static const auto start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long micros() {
+    static const auto start = std::chrono::steady_clock::now();
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+inline void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// Serial goes to stderr so tool output on stdout stays machine readable.
+// Set HOST_SERIAL_QUIET=1 in the environment to silence it.
+class HostSerial {
+private:
+    bool quiet() const {
+        static const bool q = getenv("HOST_SERIAL_QUIET") != nullptr;
+        return q;
+    }
+
+public:
+    void begin(unsigned long) {}
+    void print(const char* s) { if (!quiet()) fputs(s, stderr); }
+    void print(long v, int base = DEC) { if (!quiet()) fprintf(stderr, base == HEX ? "%lX" : "%ld", v); }
+    void print(double v) { if (!quiet()) fprintf(stderr, "%.2f", v); }
+    void println(const char* s = "") { if (!quiet()) fprintf(stderr, "%s\n", s); }
+    void println(long v, int base = DEC) { print(v, base); println(); }
+    void println(double v) { print(v); println(); }
+};
+
+inline HostSerial Serial;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,24 @@
+// Client.h (host)
+// Same interface as the Arduino core Client, so transports written against it
+// build unchanged on the host.
+#ifndef HOST_CLIENT_H
+#define HOST_CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Client {
+public:
+    virtual ~Client() {}
+    virtual int connect(const char* host, uint16_t port) = 0;
+    virtual size_t write(uint8_t value) { return write(&value, 1); }
+    virtual size_t write(const uint8_t* buf, size_t size) = 0;
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int read(uint8_t* buf, size_t size) = 0;
+    virtual void flush() {}
+    virtual void stop() = 0;
+    virtual uint8_t connected() = 0;
+};
+
+#endif // HOST_CLIENT_H
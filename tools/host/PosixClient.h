@@ -0,0 +1,111 @@
+// PosixClient.h (host)
+// Arduino Client on top of a blocking BSD TCP socket.
+#ifndef HOST_POSIX_CLIENT_H
+#define HOST_POSIX_CLIENT_H
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include "Client.h"
+
+class PosixClient : public Client {
+private:
+    int fd;
+
+public:
+    PosixClient() : fd(-1) {}
+    ~PosixClient() { stop(); }
+
+    int connect(const char* host, uint16_t port) override {
+        stop();
+        char service[8];
+        snprintf(service, sizeof(service), "%u", port);
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* result = nullptr;
+        if (getaddrinfo(host, service, &hints, &result) != 0) {
+            return 0;
+        }
+        for (struct addrinfo* ai = result; ai; ai = ai->ai_next) {
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) {
+                continue;
+            }
+            if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                break;
+            }
+            close(fd);
+            fd = -1;
+        }
+        freeaddrinfo(result);
+        return fd >= 0;
+    }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        size_t sent = 0;
+        while (fd >= 0 && sent < size) {
+            ssize_t n = send(fd, buf + sent, size - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) continue;
+                stop();
+                break;
+            }
+            sent += n;
+        }
+        return sent;
+    }
+
+    int available() override {
+        if (fd < 0) return 0;
+        int pending = 0;
+        if (ioctl(fd, FIONREAD, &pending) != 0) return 0;
+        if (pending == 0) {
+            // A readable socket with nothing pending means the peer closed it
+            char probe;
+            ssize_t n = recv(fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                stop();
+            }
+        }
+        return pending;
+    }
+
+    int read() override {
+        uint8_t value;
+        return read(&value, 1) == 1 ? value : -1;
+    }
+
+    int read(uint8_t* buf, size_t size) override {
+        if (fd < 0) return -1;
+        ssize_t n = recv(fd, buf, size, 0);
+        if (n <= 0) {
+            stop();
+            return -1;
+        }
+        return (int)n;
+    }
+
+    void stop() override {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    uint8_t connected() override {
+        if (fd >= 0) available();
+        return fd >= 0;
+    }
+};
+
+#endif // HOST_POSIX_CLIENT_H
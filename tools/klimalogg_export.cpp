@@ -0,0 +1,490 @@
+// klimalogg_export.cpp
+// Exports capture archives (see src/CaptureFormat.h) to columnar output, decoding
+// chunks of each memory-mapped file in parallel with KlimaLoggFrameParser.
+//
+// Output:
+//   --csv FILE         one row per frame: time, receiver, device, rssi, then
+//                      temperature/humidity for sensors 0-8 (empty if not present)
+//   --columns PREFIX   one raw little-endian file per column (PREFIX.<name>.<type>)
+//                      plus PREFIX.columns listing names, types and the row count
+//
+// A sparse time index (<capture>.kidx, one entry per chunk) is written the first
+// time a file is scanned completely. Later --from/--to queries only decode the
+// chunks whose time range overlaps the query.
+//
+// The records found are the same as in one sequential pass over the file, whatever
+// the chunk size: a chunk whose guessed start differs from where the previous chunk
+// really ended (only near damage) is decoded again from there.
+//
+// Build:
+//   g++ -std=c++17 -O2 -pthread -Itools/host -Isrc tools/klimalogg_export.cpp -o klimalogg_export
+//
+// Example:
+//   ./klimalogg_export --columns out/site1 --from 1704067200 --to 1706745600 archive/*.klcap
+
+#include <Arduino.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "CaptureFormat.h"
+#include "FrameParser.h"
+
+using KlimaLoggCapture::RecordHeader;
+
+// Parser diagnostics are recorded here and not printed; bad records show up as empty columns
+DeferredLog deferredLog;
+
+static const int SENSORS = 9;
+
+// Read-only memory map of a whole file
+class MappedFile {
+private:
+    int fd;
+
+public:
+    const uint8_t* data;
+    size_t size;
+
+    MappedFile() : fd(-1), data(nullptr), size(0) {}
+    ~MappedFile() {
+        if (data) munmap((void*)data, size);
+        if (fd >= 0) close(fd);
+    }
+
+    bool open(const char* path) {
+        fd = ::open(path, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) return false;
+        size = st.st_size;
+        if (size == 0) return true;
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) return false;
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = (const uint8_t*)mapped;
+        return true;
+    }
+};
+
+// Sparse time index: one entry per chunk of a capture file
+struct IndexEntry {
+    uint64_t begin;       // Offset of the first record in the chunk
+    uint64_t end;         // Offset just past the last record
+    uint32_t records;
+    uint32_t minTime;
+    uint32_t maxTime;
+    uint32_t reserved;
+};
+
+struct IndexHeader {
+    char magic[8];        // "KLIDX01\0"
+    uint64_t captureSize; // Index is stale if the capture size changed
+    uint64_t entries;
+};
+
+static const char INDEX_MAGIC[8] = { 'K', 'L', 'I', 'D', 'X', '0', '1', 0 };
+
+static bool loadIndex(const std::string& path, size_t captureSize, std::vector<IndexEntry>& entries) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    IndexHeader header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+              memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 &&
+              header.captureSize == captureSize;
+    if (ok) {
+        entries.resize(header.entries);
+        ok = fread(entries.data(), sizeof(IndexEntry), entries.size(), f) == entries.size();
+    }
+    fclose(f);
+    return ok;
+}
+
+static bool saveIndex(const std::string& path, size_t captureSize, const std::vector<IndexEntry>& entries) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    IndexHeader header;
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.captureSize = captureSize;
+    header.entries = entries.size();
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(entries.data(), sizeof(IndexEntry), entries.size(), f) == entries.size();
+    fclose(f);
+    return ok;
+}
+
+static bool headerAt(const MappedFile& file, size_t pos, RecordHeader& header) {
+    if (pos + sizeof(RecordHeader) > file.size) return false;
+    memcpy(&header, file.data + pos, sizeof(header));
+    return KlimaLoggCapture::isPlausible(header) && pos + sizeof(header) + header.length <= file.size;
+}
+
+// First record boundary at or after pos. A candidate only counts if the next
+// two records also line up, so sync words inside frame data are skipped.
+static size_t resync(const MappedFile& file, size_t pos) {
+    for (; pos + sizeof(RecordHeader) <= file.size; pos++) {
+        size_t next = pos;
+        int chained = 0;
+        RecordHeader header;
+        while (chained < 3 && headerAt(file, next, header)) {
+            next += sizeof(header) + header.length;
+            chained++;
+        }
+        if (chained == 3 || (chained > 0 && next == file.size)) {
+            return pos;
+        }
+    }
+    return file.size;
+}
+
+// Decoded rows of one chunk, stored column by column
+struct ChunkResult {
+    IndexEntry entry;
+    std::vector<uint32_t> time;
+    std::vector<uint16_t> receiver;
+    std::vector<uint16_t> device;
+    std::vector<int16_t> rssi;
+    std::vector<float> temperature[SENSORS];
+    std::vector<uint8_t> humidity[SENSORS];
+    std::string csv;
+};
+
+struct Query {
+    uint32_t from;
+    uint32_t to;
+    bool wantCsv;
+};
+
+// Decode the records starting in [begin, end). begin must be a record boundary.
+static void decodeChunk(const MappedFile& file, size_t begin, size_t end,
+                        const Query& query, ChunkResult& out) {
+    out.entry.begin = begin;
+    out.entry.records = 0;
+    out.entry.minTime = UINT32_MAX;
+    out.entry.maxTime = 0;
+    out.entry.reserved = 0;
+
+    size_t pos = begin;
+    while (pos < end) {
+        RecordHeader header;
+        if (!headerAt(file, pos, header)) {
+            // Damaged record, skip to the next boundary
+            pos = resync(file, pos + 1);
+            continue;
+        }
+        const uint8_t* payload = file.data + pos + sizeof(header);
+        pos += sizeof(header) + header.length;
+
+        out.entry.records++;
+        out.entry.minTime = min(out.entry.minTime, header.timestamp);
+        out.entry.maxTime = max(out.entry.maxTime, header.timestamp);
+        if (header.timestamp < query.from || header.timestamp > query.to || header.length < KlimaLoggFrameParser::CurrentWeatherSchema::LENGTH) {
+            continue;
+        }
+
+        KlimaLoggFrameParser::CurrentData data =
+            KlimaLoggFrameParser::parseCurrentWeatherFrame(payload, header.length);
+
+        out.time.push_back(header.timestamp);
+        out.receiver.push_back(header.receiverId);
+        out.device.push_back((payload[0] << 8) | payload[1]);
+        out.rssi.push_back(header.rssi);
+        for (int x = 0; x < SENSORS; x++) {
+            out.temperature[x].push_back(data.temperature[x]);
+            out.humidity[x].push_back(data.humidity[x]);
+        }
+
+        if (query.wantCsv) {
+            char line[512];
+            int n = snprintf(line, sizeof(line), "%u,%u,%u,%d", header.timestamp,
+                             header.receiverId, (payload[0] << 8) | payload[1], header.rssi);
+            for (int x = 0; x < SENSORS; x++) {
+                if (KlimaLoggDecode::isValidTemperature(data.temperature[x])) {
+                    n += snprintf(line + n, sizeof(line) - n, ",%.1f", data.temperature[x]);
+                } else {
+                    line[n++] = ',';
+                }
+                if (KlimaLoggDecode::isValidHumidity(data.humidity[x])) {
+                    n += snprintf(line + n, sizeof(line) - n, ",%u", data.humidity[x]);
+                } else {
+                    line[n++] = ',';
+                }
+            }
+            line[n++] = '\n';
+            out.csv.append(line, n);
+        }
+    }
+    out.entry.end = pos;
+}
+
+// Writes one raw file per column
+class ColumnWriter {
+private:
+    struct Column {
+        std::string name;
+        std::string type;
+        FILE* file;
+    };
+    std::string prefix;
+    std::vector<Column> columns;
+    uint64_t rows;
+
+    bool add(const std::string& name, const char* type) {
+        std::string path = prefix + "." + name + "." + type;
+        FILE* f = fopen(path.c_str(), "wb");
+        if (!f) return false;
+        columns.push_back({ name, type, f });
+        return true;
+    }
+
+    template <typename T>
+    void append(size_t column, const std::vector<T>& values) {
+        fwrite(values.data(), sizeof(T), values.size(), columns[column].file);
+    }
+
+public:
+    ColumnWriter() : rows(0) {}
+
+    bool open(const std::string& _prefix) {
+        prefix = _prefix;
+        bool ok = add("time", "u32") && add("receiver", "u16") &&
+                  add("device", "u16") && add("rssi", "i16");
+        for (int x = 0; ok && x < SENSORS; x++) {
+            std::string sensor = "sensor" + std::to_string(x) + "_";
+            ok = add(sensor + CurrentWeatherFields::Temperature::KEY, "f32") &&
+                 add(sensor + CurrentWeatherFields::Humidity::KEY, "u8");
+        }
+        return ok;
+    }
+
+    void write(const ChunkResult& chunk) {
+        append(0, chunk.time);
+        append(1, chunk.receiver);
+        append(2, chunk.device);
+        append(3, chunk.rssi);
+        for (int x = 0; x < SENSORS; x++) {
+            append(4 + 2 * x, chunk.temperature[x]);
+            append(5 + 2 * x, chunk.humidity[x]);
+        }
+        rows += chunk.time.size();
+    }
+
+    void close() {
+        FILE* manifest = fopen((prefix + ".columns").c_str(), "w");
+        if (manifest) {
+            fprintf(manifest, "rows %llu\n", (unsigned long long)rows);
+        }
+        for (Column& column : columns) {
+            fclose(column.file);
+            if (manifest) fprintf(manifest, "%s %s\n", column.name.c_str(), column.type.c_str());
+        }
+        if (manifest) fclose(manifest);
+        columns.clear();
+    }
+};
+
+struct Totals {
+    uint64_t bytes = 0;
+    uint64_t records = 0;
+    uint64_t rows = 0;
+    uint64_t chunksDecoded = 0;
+    uint64_t chunksSkipped = 0;
+    uint64_t chunksRedecoded = 0;
+};
+
+// Decode one capture file in parallel and emit its chunks in file order
+static bool exportFile(const char* path, const Query& query, unsigned threads, size_t chunkSize,
+                       bool useIndex, FILE* csv, ColumnWriter* columns, Totals& totals) {
+    MappedFile file;
+    if (!file.open(path)) {
+        fprintf(stderr, "%s: cannot map file\n", path);
+        return false;
+    }
+    if (file.size < sizeof(KlimaLoggCapture::FILE_MAGIC) ||
+        memcmp(file.data, KlimaLoggCapture::FILE_MAGIC, sizeof(KlimaLoggCapture::FILE_MAGIC)) != 0) {
+        fprintf(stderr, "%s: not a KlimaLogg capture file\n", path);
+        return false;
+    }
+
+    // Plan chunks: exact ranges from the index, or byte ranges resynchronised by each worker
+    std::string indexPath = std::string(path) + ".kidx";
+    std::vector<IndexEntry> index;
+    bool indexed = useIndex && loadIndex(indexPath, file.size, index);
+    bool fullScan = true;
+    std::vector<std::pair<size_t, size_t>> ranges;
+    if (indexed) {
+        for (const IndexEntry& entry : index) {
+            if (entry.records > 0 && (entry.maxTime < query.from || entry.minTime > query.to)) {
+                totals.chunksSkipped++;
+                fullScan = false;
+                continue;
+            }
+            ranges.push_back({ entry.begin, entry.end });
+        }
+    } else {
+        for (size_t begin = sizeof(KlimaLoggCapture::FILE_MAGIC); begin < file.size; begin += chunkSize) {
+            ranges.push_back({ begin, min(begin + chunkSize, file.size) });
+        }
+    }
+
+    // Workers stay at most this many chunks ahead of the writer, so memory does
+    // not grow with the archive
+    const size_t maxPending = 2 * (size_t)threads;
+    std::vector<std::unique_ptr<ChunkResult>> results(ranges.size());
+    std::atomic<size_t> nextChunk(0);
+    size_t written = 0;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable space;
+
+    auto worker = [&]() {
+        for (size_t i = nextChunk++; i < ranges.size(); i = nextChunk++) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                space.wait(lock, [&] { return i < written + maxPending; });
+            }
+            std::unique_ptr<ChunkResult> result(new ChunkResult());
+            size_t begin = ranges[i].first;
+            if (!indexed && i > 0) {
+                // The record straddling the boundary belongs to the previous chunk
+                begin = resync(file, begin);
+            }
+            decodeChunk(file, begin, max(begin, ranges[i].second), query, *result);
+            std::lock_guard<std::mutex> lock(mutex);
+            results[i] = std::move(result);
+            ready.notify_all();
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; t++) {
+        pool.emplace_back(worker);
+    }
+
+    // Write results in order as they complete, releasing each chunk once written
+    std::vector<IndexEntry> newIndex;
+    size_t previousEnd = sizeof(KlimaLoggCapture::FILE_MAGIC);
+    for (size_t i = 0; i < ranges.size(); i++) {
+        std::unique_ptr<ChunkResult> result;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [&] { return results[i] != nullptr; });
+            result = std::move(results[i]);
+        }
+        if (!indexed && result->entry.begin != previousEnd) {
+            // The worker's resync landed elsewhere than where the previous chunk
+            // stopped (damage or a sync word in frame data near the boundary);
+            // continue from the previous chunk's last good boundary instead
+            result.reset(new ChunkResult());
+            decodeChunk(file, previousEnd, max(previousEnd, ranges[i].second), query, *result);
+            totals.chunksRedecoded++;
+        }
+        previousEnd = result->entry.end;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            written = i + 1;
+            space.notify_all();
+        }
+        if (csv) fwrite(result->csv.data(), 1, result->csv.size(), csv);
+        if (columns) columns->write(*result);
+        totals.records += result->entry.records;
+        totals.rows += result->time.size();
+        totals.chunksDecoded++;
+
+        if (!indexed) {
+            newIndex.push_back(result->entry);
+        }
+    }
+    for (std::thread& t : pool) {
+        t.join();
+    }
+    totals.bytes += file.size;
+
+    if (useIndex && !indexed && fullScan && !saveIndex(indexPath, file.size, newIndex)) {
+        fprintf(stderr, "%s: could not write index\n", indexPath.c_str());
+    }
+    return true;
+}
+
+static void usage() {
+    fprintf(stderr,
+        "usage: klimalogg_export [--csv FILE] [--columns PREFIX] [--threads N]\n"
+        "                        [--chunk-size BYTES] [--from UNIX] [--to UNIX] [--no-index]\n"
+        "                        capture...\n");
+}
+
+int main(int argc, char** argv) {
+    const char* csvPath = nullptr;
+    const char* columnPrefix = nullptr;
+    unsigned threads = std::thread::hardware_concurrency();
+    size_t chunkSize = 1 << 20;
+    bool useIndex = true;
+    Query query = { 0, UINT32_MAX, false };
+    std::vector<const char*> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(arg, "--no-index")) useIndex = false;
+        else if (!strcmp(arg, "--csv") && hasValue) csvPath = argv[++i];
+        else if (!strcmp(arg, "--columns") && hasValue) columnPrefix = argv[++i];
+        else if (!strcmp(arg, "--threads") && hasValue) threads = atoi(argv[++i]);
+        else if (!strcmp(arg, "--chunk-size") && hasValue) chunkSize = strtoull(argv[++i], nullptr, 0);
+        else if (!strcmp(arg, "--from") && hasValue) query.from = strtoul(argv[++i], nullptr, 0);
+        else if (!strcmp(arg, "--to") && hasValue) query.to = strtoul(argv[++i], nullptr, 0);
+        else if (arg[0] == '-') { usage(); return 1; }
+        else inputs.push_back(arg);
+    }
+    if (inputs.empty() || threads == 0 || chunkSize < 1024) {
+        usage();
+        return 1;
+    }
+
+    FILE* csv = nullptr;
+    if (csvPath) {
+        csv = strcmp(csvPath, "-") ? fopen(csvPath, "w") : stdout;
+        if (!csv) {
+            fprintf(stderr, "cannot create %s\n", csvPath);
+            return 1;
+        }
+        fprintf(csv, "time,receiver,device,rssi");
+        for (int x = 0; x < SENSORS; x++) {
+            fprintf(csv, ",sensor%d_%s,sensor%d_%s", x, CurrentWeatherFields::Temperature::KEY,
+                    x, CurrentWeatherFields::Humidity::KEY);
+        }
+        fprintf(csv, "\n");
+        query.wantCsv = true;
+    }
+    ColumnWriter columns;
+    if (columnPrefix && !columns.open(columnPrefix)) {
+        fprintf(stderr, "cannot create column files for %s\n", columnPrefix);
+        return 1;
+    }
+
+    Totals totals;
+    auto start = std::chrono::steady_clock::now();
+    int failures = 0;
+    for (const char* input : inputs) {
+        if (!exportFile(input, query, threads, chunkSize, useIndex, csv,
+                        columnPrefix ? &columns : nullptr, totals)) {
+            failures++;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (csv && csv != stdout) fclose(csv);
+    if (columnPrefix) columns.close();
+
+    fprintf(stderr, "%zu files, %.1f MB, %llu records, %llu rows exported, "
+                    "%llu chunks decoded (%llu again from the previous boundary), %llu skipped by index\n",
+            inputs.size(), totals.bytes / 1e6, (unsigned long long)totals.records,
+            (unsigned long long)totals.rows, (unsigned long long)totals.chunksDecoded,
+            (unsigned long long)totals.chunksRedecoded, (unsigned long long)totals.chunksSkipped);
+    fprintf(stderr, "%u threads, %.3f s, %.0f records/s, %.1f MB/s\n",
+            threads, seconds, totals.records / seconds, totals.bytes / 1e6 / seconds);
+    return failures ? 1 : 0;
+}
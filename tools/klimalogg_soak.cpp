@@ -0,0 +1,713 @@
+// klimalogg_soak.cpp
+// Soak and load test of the receive path without radios. Builds valid current
+// weather frames for N virtual stations, adds corruption, duplicates, bit shifts,
+// timing jitter and on-air collisions, and pushes them through the same
+// receive -> validate -> parse -> publish steps as the firmware (ReceivePath.h) on
+// a virtual clock. Frames are the full 235 bytes, so the alarm block with the
+// battery flags is encoded and checked too.
+//
+// The firmware's tasks each run on their own schedule of the virtual clock:
+// - The decoder is fed by a bounded receive queue: frames received over the air wait
+//   in --rx-queue slots (rtl_433_ESP's pulse train buffers, or the fast path's edge
+//   ring, which holds about two frames), and a frame that ends while the queue is
+//   full is lost. Each frame costs the host CPU time its processing actually took,
+//   times --cpu-scale. The decoder takes a FramePool buffer when it starts on a
+//   frame, as KlimaLoggPulseDecoder does, and lets go of it when the frame is done.
+// - The publisher task collects the station table every 50 ms after its previous
+//   run, as publisherTask in main does, and runs BatchPublisher::loop. During an
+//   --outage every connection attempt blocks it for --connect-ms. There is no flash
+//   queue here (publish_sim covers that), so batches due while the link is down are
+//   lost and counted as such.
+// - With --capture, the recorder task keeps its reference to each pooled frame until
+//   it drains, every 50 ms when idle, and each drain keeps it busy for --flash-ms.
+//
+// Every accepted reading is followed to the transport: it is either published, or
+// replaced by a newer reading of the same station, or counted with the cause it was
+// lost to. Latency is measured from the end of the frame on air to publish(). Each
+// accepted frame is compared with what was sent; the run fails (exit status 2) if an
+// intact frame decodes wrong, if more than --max-wrong damaged frames are accepted
+// with wrong readings or station id, or if a reading goes missing on the way.
+//
+// Build:
+//   g++ -std=c++17 -O2 -Itools/host -Isrc tools/klimalogg_soak.cpp -o klimalogg_soak
+//
+// Examples:
+//   ./klimalogg_soak --stations 12 --minutes 60 --corrupt 2 --duplicate 1 --max-wrong 100
+//   ./klimalogg_soak --stations 12 --minutes 30 --outage 600:120
+//   ./klimalogg_soak --stations 200 --scale 10 --no-collisions --cpu-scale 3000 --rx-queue 1
+
+#include <Arduino.h>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include "BatchPublisher.h"
+#include "DeferredLog.h"
+#include "FramePool.h"
+#include "FrameRecorder.h"
+#include "ReceivePath.h"
+
+DeferredLog deferredLog;
+
+static const size_t FRAME_LENGTH = KlimaLoggFrameParser::CurrentWeatherSchema::FULL_LENGTH;
+static const uint32_t UNIX_BASE = 1700000000;
+
+// Frame plus HDLC preamble and flags at 17.241 kbit/s
+static const uint32_t AIRTIME_US = (uint32_t)((FRAME_LENGTH + 16) * 8 * 1000000ULL / 17241);
+
+// vTaskDelay of the publisher and recorder tasks between runs
+static const uint64_t TASK_DELAY_US = 50000;
+
+struct Options {
+    int stations = 20;
+    double intervalSec = 10;
+    double scale = 1;
+    double minutes = 10;
+    double corruptPercent = 0;
+    double duplicatePercent = 0;
+    double shiftPercent = 0;
+    double jitterMs = 50;
+    double cpuScale = 1;
+    int rxQueue = 2;
+    bool collisions = true;
+    double outageStartSec = 0;
+    double outageSec = 0;
+    double connectMs = 3000;
+    double flashMs = 25;
+    uint64_t maxWrong = 0;
+    const char* capture = nullptr;
+    unsigned seed = 1;
+};
+
+// Link to the broker as the publisher task sees it: up except during the outage,
+// when each connect() blocks the task and fails. Every published message is handed
+// to onMessage at the virtual time of the call.
+class SoakTransport : public PublishTransport {
+public:
+    uint64_t now = 0;                  // Publisher task's virtual time, us
+    uint64_t outageStart = 0, outageEnd = 0;
+    uint64_t connectUs = 0;
+    uint32_t messages = 0, failedConnects = 0;
+    uint64_t bytes = 0;
+    std::function<void(const uint8_t*, size_t)> onMessage;
+
+    bool down() const { return now >= outageStart && now < outageEnd; }
+
+    bool connect() override {
+        if (down()) {
+            now += connectUs;
+            failedConnects++;
+            return false;
+        }
+        up = true;
+        return true;
+    }
+    bool connected() override {
+        if (down()) {
+            up = false;
+        }
+        return up;
+    }
+    bool publish(const uint8_t* payload, size_t length) override {
+        if (!connected()) {
+            return false;
+        }
+        messages++;
+        bytes += length;
+        onMessage(payload, length);
+        return true;
+    }
+
+private:
+    bool up = false;
+};
+
+struct NullOutput {
+    size_t write(const uint8_t*, size_t size) { return size; }
+};
+
+// Latency histogram with 2% wide buckets, so long runs use constant memory
+class LatencyHistogram {
+private:
+    static const int BUCKETS = 1200;
+    uint64_t counts[BUCKETS] = {};
+    uint64_t total = 0;
+    uint64_t maxUs = 0;
+
+    static int bucketOf(uint64_t us) {
+        int b = us < 1 ? 0 : (int)(log((double)us) / log(1.02)) + 1;
+        return b < BUCKETS ? b : BUCKETS - 1;
+    }
+
+public:
+    void add(uint64_t us) {
+        counts[bucketOf(us)]++;
+        total++;
+        maxUs = us > maxUs ? us : maxUs;
+    }
+
+    uint64_t percentile(double p) const {
+        uint64_t target = (uint64_t)ceil(total * p / 100.0), seen = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            seen += counts[b];
+            if (seen >= target && seen > 0) {
+                return b == 0 ? 0 : (uint64_t)pow(1.02, b);
+            }
+        }
+        return maxUs;
+    }
+
+    uint64_t max() const { return maxUs; }
+    uint64_t count() const { return total; }
+
+    void print(const char* label, double divisor, const char* unit) const {
+        printf("%-20s p50 %.1f %s, p90 %.1f %s, p99 %.1f %s, max %.1f %s\n", label,
+               percentile(50) / divisor, unit, percentile(90) / divisor, unit,
+               percentile(99) / divisor, unit, max() / divisor, unit);
+    }
+};
+
+struct Station {
+    uint16_t deviceId;
+    int sensors;
+    KlimaLoggFrameParser::CurrentData data;
+};
+
+struct Transmission {
+    uint64_t start;
+    uint64_t end;
+    uint16_t station;
+    bool collided;
+    bool damaged;                 // Corrupted or shifted on purpose
+    bool duplicate;
+    std::vector<uint8_t> frame;
+    KlimaLoggFrameParser::CurrentData sent;
+};
+
+struct Received {
+    std::vector<uint8_t> frame;
+    uint64_t arrival;
+    bool damaged;
+    uint16_t deviceId;
+    KlimaLoggFrameParser::CurrentData sent;
+};
+
+// An accepted reading on its way to the transport
+struct Reading {
+    uint64_t arrival;
+    bool wrong;                   // Differs from what the station sent
+};
+
+struct Counters {
+    uint64_t offered = 0, duplicates = 0, damaged = 0, collided = 0, queueDrops = 0, noBuffer = 0;
+    uint64_t processed = 0, invalid = 0, accepted = 0, acceptedWrong = 0, intactWrong = 0;
+    double busyUs = 0, cpuUs = 0;
+
+    // Where accepted readings went
+    uint64_t published = 0, publishedWrong = 0, replacedInTable = 0, replacedInBatch = 0;
+    uint64_t linkDown = 0, tableFull = 0, leftBehind = 0;
+
+    uint64_t publisherRuns = 0, maxPollGapUs = 0, recorderDrains = 0;
+};
+
+static void usage() {
+    fprintf(stderr,
+        "usage: klimalogg_soak [--stations N] [--interval SEC] [--scale X] [--minutes M]\n"
+        "                      [--corrupt PCT] [--duplicate PCT] [--shift PCT] [--jitter MS]\n"
+        "                      [--cpu-scale X] [--rx-queue FRAMES] [--no-collisions]\n"
+        "                      [--outage START_SEC:DURATION_SEC] [--connect-ms MS]\n"
+        "                      [--capture FILE] [--flash-ms MS] [--max-wrong N] [--seed N]\n");
+}
+
+// Random walk of the readings, with min/max and their times kept consistent
+static void updateReadings(Station& s, uint64_t nowUs, std::mt19937& rng) {
+    std::normal_distribution<float> step(0, 0.2f);
+    uint32_t minute = (UNIX_BASE + (uint32_t)(nowUs / 1000000)) / 60 * 60;
+    KlimaLoggFrameParser::CurrentData& d = s.data;
+    for (int x = 0; x < s.sensors; x++) {
+        float t = roundf((d.temperature[x] + step(rng)) * 10) / 10;
+        t = t < -39.9f ? -39.9f : (t > 59.9f ? 59.9f : t);
+        int h = d.humidity[x] + (int)roundf(step(rng) * 5);
+        h = h < 1 ? 1 : (h > 99 ? 99 : h);
+        d.temperature[x] = t;
+        d.humidity[x] = h;
+        if (t > d.temperatureMax[x]) { d.temperatureMax[x] = t; d.temperatureMaxTS[x] = minute; }
+        if (t < d.temperatureMin[x]) { d.temperatureMin[x] = t; d.temperatureMinTS[x] = minute; }
+        if (h > d.humidityMax[x]) { d.humidityMax[x] = h; d.humidityMaxTS[x] = minute; }
+        if (h < d.humidityMin[x]) { d.humidityMin[x] = h; d.humidityMinTS[x] = minute; }
+    }
+}
+
+static std::vector<uint8_t> buildFrame(const Station& s) {
+    std::vector<uint8_t> frame(FRAME_LENGTH, 0);
+    KlimaLoggFrameParser::encodeCurrentWeatherFrame(s.data, frame.data(), frame.size());
+    frame[0] = s.deviceId >> 8;
+    frame[1] = s.deviceId & 0xFF;
+    return frame;
+}
+
+// Shift the whole frame by 1-7 bits, as after a missed or extra clock edge
+static void shiftFrame(std::vector<uint8_t>& frame, int bits) {
+    for (size_t i = frame.size(); i-- > 0;) {
+        uint8_t carry = i > 0 ? frame[i - 1] << (8 - bits) : 0;
+        frame[i] = (frame[i] >> bits) | carry;
+    }
+}
+
+// Compares what a batch publishes: temperature, humidity and battery of each channel
+static bool sameReadings(const KlimaLoggFrameParser::CurrentData& a, const KlimaLoggFrameParser::CurrentData& b) {
+    for (int x = 0; x < 9; x++) {
+        bool va = KlimaLoggDecode::isValidTemperature(a.temperature[x]);
+        bool vb = KlimaLoggDecode::isValidTemperature(b.temperature[x]);
+        if (va != vb || (va && (fabsf(a.temperature[x] - b.temperature[x]) > 0.05f ||
+                                a.humidity[x] != b.humidity[x] ||
+                                KlimaLoggFrameParser::getBatteryStatus(a.alarmData, x) !=
+                                KlimaLoggFrameParser::getBatteryStatus(b.alarmData, x)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Stands between ReceivePath::forward and the BatchPublisher to follow readings
+// from the station table into batches
+class TracingPublisher {
+private:
+    BatchPublisher& publisher;
+    std::map<uint16_t, Reading>& collected;
+    std::map<uint16_t, Reading>& batched;
+    Counters& c;
+
+public:
+    TracingPublisher(BatchPublisher& _publisher, std::map<uint16_t, Reading>& _collected,
+                     std::map<uint16_t, Reading>& _batched, Counters& _c) :
+        publisher(_publisher), collected(_collected), batched(_batched), c(_c) {}
+
+    void add(uint16_t deviceId, const KlimaLoggFrameParser::CurrentData& data,
+             int rssi, uint32_t receivedAt, unsigned long now) {
+        uint32_t batches = publisher.getStats().batches;
+        publisher.add(deviceId, data, rssi, receivedAt, now);
+        if (publisher.getStats().batches != batches) {
+            // add() flushed a full batch; whatever was not published with it is lost
+            c.linkDown += batched.size();
+            batched.clear();
+        }
+        auto reading = collected.find(deviceId);
+        if (reading == collected.end()) {
+            return;
+        }
+        if (batched.count(deviceId)) {
+            c.replacedInBatch++;
+        }
+        batched[deviceId] = reading->second;
+        collected.erase(reading);
+    }
+};
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--stations" && more) opt.stations = atoi(argv[++i]);
+        else if (a == "--interval" && more) opt.intervalSec = atof(argv[++i]);
+        else if (a == "--scale" && more) opt.scale = atof(argv[++i]);
+        else if (a == "--minutes" && more) opt.minutes = atof(argv[++i]);
+        else if (a == "--corrupt" && more) opt.corruptPercent = atof(argv[++i]);
+        else if (a == "--duplicate" && more) opt.duplicatePercent = atof(argv[++i]);
+        else if (a == "--shift" && more) opt.shiftPercent = atof(argv[++i]);
+        else if (a == "--jitter" && more) opt.jitterMs = atof(argv[++i]);
+        else if (a == "--cpu-scale" && more) opt.cpuScale = atof(argv[++i]);
+        else if (a == "--rx-queue" && more) opt.rxQueue = atoi(argv[++i]);
+        else if (a == "--no-collisions") opt.collisions = false;
+        else if (a == "--outage" && more) sscanf(argv[++i], "%lf:%lf", &opt.outageStartSec, &opt.outageSec);
+        else if (a == "--connect-ms" && more) opt.connectMs = atof(argv[++i]);
+        else if (a == "--capture" && more) opt.capture = argv[++i];
+        else if (a == "--flash-ms" && more) opt.flashMs = atof(argv[++i]);
+        else if (a == "--max-wrong" && more) opt.maxWrong = strtoull(argv[++i], nullptr, 10);
+        else if (a == "--seed" && more) opt.seed = atoi(argv[++i]);
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if (opt.stations < 1 || opt.stations > 65535 || opt.intervalSec <= 0 || opt.scale <= 0 ||
+        opt.rxQueue < 1 || opt.connectMs < 0 || opt.flashMs < 0) {
+        usage();
+        return 1;
+    }
+    std::mt19937 rng(opt.seed);
+    std::uniform_real_distribution<double> percent(0, 100);
+    const uint64_t intervalUs = (uint64_t)(opt.intervalSec * 1000000 / opt.scale);
+    const uint64_t endUs = (uint64_t)(opt.minutes * 60 * 1000000);
+    const int64_t jitterUs = (int64_t)(opt.jitterMs * 1000);
+
+    // Stations with 1-9 sensors each and a random phase
+    std::vector<Station> stations(opt.stations);
+    typedef std::pair<uint64_t, uint16_t> Due;
+    std::priority_queue<Due, std::vector<Due>, std::greater<Due>> schedule;
+    for (int i = 0; i < opt.stations; i++) {
+        Station& s = stations[i];
+        s.deviceId = 0x1000 + i;
+        s.sensors = 1 + rng() % 9;
+        s.data.signalQuality = 70 + rng() % 30;
+        for (int x = 0; x < s.sensors; x++) {
+            s.data.temperature[x] = s.data.temperatureMax[x] = s.data.temperatureMin[x] = 15 + rng() % 10;
+            s.data.humidity[x] = s.data.humidityMax[x] = s.data.humidityMin[x] = 40 + rng() % 30;
+            s.data.temperatureMaxTS[x] = s.data.temperatureMinTS[x] = UNIX_BASE / 60 * 60;
+            s.data.humidityMaxTS[x] = s.data.humidityMinTS[x] = UNIX_BASE / 60 * 60;
+            // About one sensor in ten with a low battery
+            if (rng() % 10 == 0) {
+                if (x == 0) {
+                    s.data.alarmData[1] |= 0x80;
+                } else {
+                    s.data.alarmData[0] |= 1 << (x - 1);
+                }
+            }
+        }
+        schedule.push(Due(rng() % intervalUs, i));
+    }
+
+    // Receive path, set up as in main
+    FramePool framePool;
+    SnapshotPublisher<KlimaLoggSnapshot> latestReadings;
+    StationTable<KlimaLoggSnapshot> stationReadings;
+    FrameRecorder frameRecorder;
+    ReceivePath receivePath(latestReadings);
+    receivePath.setStationTable(&stationReadings);
+    if (opt.capture) {
+        receivePath.setRecorder(&frameRecorder);
+    }
+    SoakTransport transport;
+    transport.outageStart = (uint64_t)(opt.outageStartSec * 1000000);
+    transport.outageEnd = transport.outageStart + (uint64_t)(opt.outageSec * 1000000);
+    transport.connectUs = (uint64_t)(opt.connectMs * 1000);
+    BatchPublisher batchPublisher(transport);
+    NullOutput logSink;
+    if (opt.capture && !frameRecorder.begin(opt.capture, UINT32_MAX, 1)) {
+        fprintf(stderr, "cannot write %s\n", opt.capture);
+        return 1;
+    }
+
+    std::deque<Transmission> onAir;                         // Ordered by end, all the same airtime
+    std::vector<Transmission> late;                          // Duplicates waiting to go on air
+    std::deque<Received> waiting;
+    Counters c;
+    LatencyHistogram decodeLatency, endToEnd;
+    uint64_t decoderFreeAt = 0, publisherAt = 0;
+    StationTable<KlimaLoggSnapshot>::Reader reader;
+
+    // Latest accepted reading of each station: in the table, collected into the
+    // open batch. Keyed by the decoded station id, which a damaged frame may get wrong.
+    std::map<uint16_t, Reading> inTable, inBatch;
+    TracingPublisher tracer(batchPublisher, inTable, inBatch, c);
+
+    // Publisher CPU time so far in the current run, on the virtual clock
+    std::chrono::steady_clock::time_point publisherCpuStart;
+    auto publisherCpuUs = [&]() {
+        return (uint64_t)(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - publisherCpuStart).count() * opt.cpuScale);
+    };
+
+    // A batch went out: every station in it has been published
+    transport.onMessage = [&](const uint8_t* payload, size_t length) {
+        uint64_t at = transport.now + publisherCpuUs();
+        std::string json((const char*)payload, length);
+        for (size_t pos = json.find("\"id\":"); pos != std::string::npos; pos = json.find("\"id\":", pos + 1)) {
+            auto reading = inBatch.find((uint16_t)strtoul(json.c_str() + pos + 5, nullptr, 10));
+            if (reading == inBatch.end()) {
+                continue;
+            }
+            c.published++;
+            c.publishedWrong += reading->second.wrong;
+            endToEnd.add(at - reading->second.arrival);
+            inBatch.erase(reading);
+        }
+    };
+
+    auto startTransmission = [&](Transmission&& t) {
+        if (opt.collisions) {
+            for (Transmission& other : onAir) {
+                if (other.end > t.start) {
+                    other.collided = true;
+                    t.collided = true;
+                }
+            }
+        }
+        onAir.push_back(std::move(t));
+    };
+
+    // Frame fully received: queue it for the decoder, or lose it if the queue is full.
+    // Frames the decoder has started on have already left the queue (see runDecoder).
+    auto deliver = [&](Transmission& t) {
+        if (t.collided) {
+            c.collided++;
+            return;
+        }
+        if (waiting.size() >= (size_t)opt.rxQueue) {
+            c.queueDrops++;
+            return;
+        }
+        waiting.push_back(Received{ std::move(t.frame), t.end, t.damaged,
+                                    stations[t.station].deviceId, t.sent });
+    };
+
+    // The decoder writes the next frame into a pool buffer and runs the firmware's
+    // receive steps on it; the recorder keeps its own reference
+    auto runDecoder = [&](uint64_t start) {
+        Received r = std::move(waiting.front());
+        waiting.pop_front();
+
+        auto cpuStart = std::chrono::steady_clock::now();
+        FrameHandle frame = framePool.acquire();
+        if (!frame) {
+            c.noBuffer++;
+            return;
+        }
+        memcpy(frame.data(), r.frame.data(), r.frame.size());
+        frame.setLength(r.frame.size());
+        frame.setRssi(-60 - (int)(rng() % 30));
+        KlimaLoggSnapshot snapshot;
+        uint32_t tableDropped = stationReadings.getDropped();
+        bool valid = receivePath.process(frame, UNIX_BASE + (uint32_t)(start / 1000000),
+                                         start / 1000, snapshot);
+        frame.release();
+        deferredLog.drain(logSink, true);
+        double cpuUs = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - cpuStart).count() * opt.cpuScale;
+
+        c.processed++;
+        c.cpuUs += cpuUs;
+        c.busyUs += (uint64_t)cpuUs;
+        decoderFreeAt = start + (uint64_t)cpuUs;
+        decodeLatency.add(decoderFreeAt - r.arrival);
+        if (!valid) {
+            c.invalid++;
+            return;
+        }
+
+        // Ground truth: the station and readings the batch will carry
+        c.accepted++;
+        bool wrong = snapshot.deviceId != r.deviceId || !sameReadings(snapshot.data, r.sent);
+        if (wrong) {
+            // Intact frames must decode exactly, battery flags included
+            r.damaged ? c.acceptedWrong++ : c.intactWrong++;
+        }
+        if (stationReadings.getDropped() != tableDropped) {
+            c.tableFull++;
+            return;
+        }
+        if (inTable.count(snapshot.deviceId)) {
+            c.replacedInTable++;
+        }
+        inTable[snapshot.deviceId] = Reading{ r.arrival, wrong };
+    };
+
+    // One pass of publisherTask
+    auto runPublisher = [&](uint64_t start) {
+        if (c.publisherRuns > 0) {
+            c.maxPollGapUs = std::max(c.maxPollGapUs, start - publisherAt);
+        }
+        c.publisherRuns++;
+        transport.now = start;
+        publisherCpuStart = std::chrono::steady_clock::now();
+        receivePath.forward(reader, tracer, start / 1000);
+        // Every station updated before this run must have been collected
+        c.leftBehind += inTable.size();
+        inTable.clear();
+
+        uint32_t batches = batchPublisher.getStats().batches;
+        batchPublisher.loop(start / 1000);
+        if (batchPublisher.getStats().batches != batches) {
+            c.linkDown += inBatch.size();
+            inBatch.clear();
+        }
+        publisherAt = start;
+        return transport.now + publisherCpuUs() + TASK_DELAY_US;
+    };
+
+    // One pass of the recorder task: busy for --flash-ms per drain, else sleeps
+    auto runRecorder = [&](uint64_t start) {
+        if (frameRecorder.drain() == 0) {
+            return start + TASK_DELAY_US;
+        }
+        c.recorderDrains++;
+        return start + (uint64_t)(opt.flashMs * 1000);
+    };
+
+    // Run the tasks up to time until, each at its own next wake-up
+    uint64_t publisherNext = 0, recorderNext = opt.capture ? 0 : UINT64_MAX;
+    auto advance = [&](uint64_t until) {
+        for (;;) {
+            uint64_t decoderNext = waiting.empty() ? UINT64_MAX
+                                                   : std::max(decoderFreeAt, waiting.front().arrival);
+            uint64_t next = std::min(std::min(decoderNext, publisherNext), recorderNext);
+            if (next > until) {
+                break;
+            }
+            if (next == decoderNext) {
+                runDecoder(next);
+            } else if (next == recorderNext) {
+                recorderNext = runRecorder(next);
+            } else {
+                publisherNext = runPublisher(next);
+            }
+        }
+    };
+
+    uint64_t lastEvent = 0;
+    for (;;) {
+        // Next event: a station transmits, a duplicate goes on air, or a frame ends
+        uint64_t nextStart = schedule.empty() ? UINT64_MAX : schedule.top().first;
+        uint64_t nextLate = UINT64_MAX;
+        size_t lateIndex = 0;
+        for (size_t i = 0; i < late.size(); i++) {
+            if (late[i].start < nextLate) {
+                nextLate = late[i].start;
+                lateIndex = i;
+            }
+        }
+        uint64_t nextEnd = onAir.empty() ? UINT64_MAX : onAir.front().end;
+        uint64_t now = std::min(std::min(nextStart, nextLate), nextEnd);
+        if (now == UINT64_MAX || (now >= endUs && onAir.empty() && late.empty())) {
+            break;
+        }
+        advance(now);
+        lastEvent = now;
+
+        if (now == nextEnd) {
+            Transmission t = std::move(onAir.front());
+            onAir.pop_front();
+            deliver(t);
+        } else if (now == nextLate) {
+            Transmission t = std::move(late[lateIndex]);
+            late.erase(late.begin() + lateIndex);
+            startTransmission(std::move(t));
+        } else {
+            uint16_t id = schedule.top().second;
+            schedule.pop();
+            if (now >= endUs) {
+                continue;
+            }
+            Station& s = stations[id];
+            updateReadings(s, now, rng);
+
+            Transmission t;
+            t.start = now;
+            t.end = now + AIRTIME_US;
+            t.station = id;
+            t.collided = false;
+            t.duplicate = false;
+            t.damaged = false;
+            t.frame = buildFrame(s);
+            t.sent = s.data;
+            if (percent(rng) < opt.corruptPercent) {
+                for (int n = 1 + rng() % 4; n > 0; n--) {
+                    t.frame[rng() % t.frame.size()] ^= 1 << (rng() % 8);
+                }
+                t.damaged = true;
+                c.damaged++;
+            }
+            if (percent(rng) < opt.shiftPercent) {
+                shiftFrame(t.frame, 1 + rng() % 7);
+                t.damaged = true;
+                c.damaged++;
+            }
+            if (percent(rng) < opt.duplicatePercent) {
+                // Retransmission shortly after the original
+                Transmission copy = t;
+                copy.start = t.end + 20000 + rng() % 180000;
+                copy.end = copy.start + AIRTIME_US;
+                copy.duplicate = true;
+                late.push_back(std::move(copy));
+                c.duplicates++;
+            }
+            c.offered++;
+            startTransmission(std::move(t));
+
+            int64_t next = (int64_t)(now + intervalUs);
+            if (jitterUs > 0) {
+                next += (int64_t)(rng() % (2 * jitterUs + 1)) - jitterUs;
+            }
+            schedule.push(Due((uint64_t)std::max<int64_t>(next, now + 1), id));
+        }
+    }
+    // Let the decoder finish and the last batch window close; readings still on
+    // their way after that never reached the transport
+    uint64_t settle = std::max(lastEvent, transport.outageEnd) + 2 * BatchPublisher::Config().windowMs * 1000;
+    advance(settle);
+    const uint64_t unpublished = inTable.size() + inBatch.size();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    const double seconds = std::max(decoderFreeAt, endUs) / 1e6;
+    const uint64_t transmitted = c.offered + c.duplicates;
+    const uint64_t dropped = c.collided + c.queueDrops + c.noBuffer;
+    const uint64_t wrong = c.acceptedWrong + c.intactWrong;
+    const double serviceUs = c.processed ? c.busyUs / c.processed : 0;
+    FramePool::Stats pool = framePool.getStats();
+    FrameRecorder::Stats recorder = frameRecorder.getStats();
+
+    printf("virtual time:       %.1f s, %d stations, %.2f frames/s offered\n",
+           seconds, opt.stations, transmitted / seconds);
+    printf("transmitted:        %llu (%llu duplicates, %llu damaged)\n",
+           (unsigned long long)transmitted, (unsigned long long)c.duplicates, (unsigned long long)c.damaged);
+    printf("dropped:            %llu (%.2f%%): %llu collisions, %llu receive queue full, %llu no frame buffer\n",
+           (unsigned long long)dropped, transmitted ? 100.0 * dropped / transmitted : 0.0,
+           (unsigned long long)c.collided, (unsigned long long)c.queueDrops, (unsigned long long)c.noBuffer);
+    printf("processed:          %llu, %.2f frames/s sustained\n",
+           (unsigned long long)c.processed, c.processed / seconds);
+    printf("validation:         %llu accepted, %llu rejected\n",
+           (unsigned long long)c.accepted, (unsigned long long)c.invalid);
+    printf("ground truth:       %llu accepted with wrong readings or station id (%llu damaged, %llu intact), "
+           "%llu of them published\n",
+           (unsigned long long)wrong, (unsigned long long)c.acceptedWrong, (unsigned long long)c.intactWrong,
+           (unsigned long long)c.publishedWrong);
+    printf("readings:           %llu published, %llu replaced by a newer one of the station "
+           "(%llu in the table, %llu in a batch)\n",
+           (unsigned long long)c.published, (unsigned long long)(c.replacedInTable + c.replacedInBatch),
+           (unsigned long long)c.replacedInTable, (unsigned long long)c.replacedInBatch);
+    printf("readings lost:      %llu station table full, %llu link down, %llu left behind by the publisher, "
+           "%llu never published\n",
+           (unsigned long long)c.tableFull, (unsigned long long)c.linkDown,
+           (unsigned long long)c.leftBehind, (unsigned long long)unpublished);
+    printf("service time:       %.1f us/frame (%.2f us CPU), capacity %.1f frames/s, utilisation %.1f%%\n",
+           serviceUs, c.processed ? c.cpuUs / c.processed : 0.0,
+           serviceUs > 0 ? 1e6 / serviceUs : 0.0, 100.0 * c.busyUs / (seconds * 1e6));
+    decodeLatency.print("decode latency:", 1, "us");
+    endToEnd.print("end-to-end latency:", 1000, "ms");
+    printf("frame pool:         %u acquired, high water %u of %u, %u exhausted\n",
+           pool.acquired, pool.highWater, (unsigned)FramePool::size(), pool.exhausted);
+    if (opt.capture) {
+        printf("recorder:           %u recorded, %u dropped, %llu drains\n",
+               recorder.recorded, recorder.dropped, (unsigned long long)c.recorderDrains);
+    }
+    printf("publisher:          %llu runs, longest poll gap %.1f ms, %u batches, %u messages, %llu bytes, "
+           "%u failed connects\n",
+           (unsigned long long)c.publisherRuns, c.maxPollGapUs / 1000.0, batchPublisher.getStats().batches,
+           transport.messages, (unsigned long long)transport.bytes, transport.failedConnects);
+    printf("peak memory:        %ld KiB RSS (pipeline state %zu bytes)\n", usage.ru_maxrss,
+           sizeof(framePool) + sizeof(latestReadings) + sizeof(batchPublisher) + sizeof(deferredLog) +
+           sizeof(stationReadings) + sizeof(frameRecorder));
+
+    bool failed = false;
+    if (c.intactWrong) {
+        printf("FAIL: intact frames decoded wrong\n");
+        failed = true;
+    }
+    if (c.acceptedWrong > opt.maxWrong) {
+        printf("FAIL: %llu damaged frames accepted with wrong readings, --max-wrong %llu\n",
+               (unsigned long long)c.acceptedWrong, (unsigned long long)opt.maxWrong);
+        failed = true;
+    }
+    if (c.leftBehind || unpublished) {
+        printf("FAIL: readings went missing between the decoder and the transport\n");
+        failed = true;
+    }
+    return failed ? 2 : 0;
+}
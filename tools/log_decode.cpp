@@ -0,0 +1,69 @@
+// log_decode.cpp
+// Formats the binary DeferredLog stream (firmware built with -DDLOG_BINARY_OUTPUT)
+// captured from the serial port. Anything between records, such as regular
+// ArduinoLog text, is passed through unchanged. Must be built from the same
+// revision as the firmware, since messages are identified by their position in
+// src/LogMessages.h.
+//
+// Build:
+//   g++ -std=c++17 -O2 -Itools/host -Isrc tools/log_decode.cpp -o log_decode
+//
+// Examples:
+//   ./log_decode capture.bin
+//   cat /dev/ttyUSB0 | ./log_decode
+
+#include <Arduino.h>
+#include "DeferredLog.h"
+
+DeferredLog deferredLog;
+
+// Adapts stdio to the write(const uint8_t*, size_t) interface DeferredLog emits to
+struct FileOutput {
+    FILE* file;
+    size_t write(const uint8_t* data, size_t size) {
+        return fwrite(data, 1, size, file);
+    }
+};
+
+int main(int argc, char** argv) {
+    FILE* in = stdin;
+    if (argc > 2 || (argc == 2 && !(in = fopen(argv[1], "rb")))) {
+        fprintf(stderr, "usage: log_decode [capture.bin]\n");
+        return 1;
+    }
+
+    FileOutput out = { stdout };
+    const size_t frameSize = 2 + sizeof(DeferredLog::Record);
+    uint8_t window[frameSize];
+    size_t filled = 0;
+    unsigned long records = 0, rejected = 0;
+
+    // Slide over the input; emit a record whenever the window holds a valid frame,
+    // otherwise pass the first byte through
+    for (;;) {
+        while (filled < frameSize) {
+            int c = fgetc(in);
+            if (c == EOF) break;
+            window[filled++] = (uint8_t)c;
+        }
+        if (filled == 0) break;
+
+        if (filled == frameSize && window[0] == DeferredLog::SYNC0 && window[1] == DeferredLog::SYNC1) {
+            DeferredLog::Record record;
+            memcpy(&record, window + 2, sizeof(record));
+            if (DeferredLog::messageInfo(record.id) && record.length <= DeferredLog::MAX_ARGS) {
+                DeferredLog::emit(out, record, false);
+                records++;
+                filled = 0;
+                continue;
+            }
+            rejected++;
+        }
+        fputc(window[0], stdout);
+        memmove(window, window + 1, --filled);
+    }
+
+    fflush(stdout);
+    fprintf(stderr, "%lu records decoded, %lu rejected sync candidates\n", records, rejected);
+    return 0;
+}
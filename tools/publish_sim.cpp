@@ -0,0 +1,370 @@
+// publish_sim.cpp
+// Drives BatchPublisher on the host with synthetic readings from several stations,
+// sending over MQTT to a real broker or to a built-in stand-in broker, with an
+// optional simulated outage (connections refused and reset) and an optional silent
+// link (half-open: writes succeed, nothing arrives in either direction, new
+// connections time out). Runs on a virtual clock, so hours of traffic take seconds.
+// With the stand-in broker, every batch built must have arrived, still be queued
+// or have been dropped by a full queue; otherwise the run exits non-zero.
+//
+// Build:
+//   g++ -std=c++17 -O2 -pthread -Itools/host -Isrc tools/publish_sim.cpp -o publish_sim
+//
+// Examples:
+//   ./publish_sim --stations 6 --minutes 30 --outage 600:300
+//   ./publish_sim --stations 6 --minutes 30 --silent 600:300
+//   ./publish_sim --broker localhost:1883 --window 10 --drain 2
+
+#include <Arduino.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+#include "PosixClient.h"
+#include "BatchPublisher.h"
+#include "MqttTransport.h"
+
+DeferredLog deferredLog;
+
+// Accepts MQTT connections and counts PUBLISH packets; nothing is routed anywhere
+class StandInBroker {
+private:
+    int listenFd;
+    uint16_t port;
+    std::thread worker;
+    std::atomic<bool> running;
+    std::mutex lock;
+    std::set<std::string> payloads;
+
+    static bool readFully(int fd, uint8_t* buf, size_t size) {
+        size_t got = 0;
+        while (got < size) {
+            ssize_t n = recv(fd, buf + got, size - got, 0);
+            if (n <= 0) return false;
+            got += n;
+        }
+        return true;
+    }
+
+    void serve(int fd) {
+        std::vector<uint8_t> body;
+        while (running) {
+            uint8_t type;
+            if (!readFully(fd, &type, 1)) break;
+            size_t remaining = 0, shift = 0;
+            uint8_t digit;
+            do {
+                if (!readFully(fd, &digit, 1)) return;
+                remaining |= (size_t)(digit & 0x7F) << shift;
+                shift += 7;
+            } while (digit & 0x80);
+            body.resize(remaining);
+            if (remaining && !readFully(fd, body.data(), remaining)) break;
+
+            switch (type & 0xF0) {
+                case 0x10: { // CONNECT
+                    const uint8_t connack[4] = { 0x20, 0x02, 0x00, 0x00 };
+                    send(fd, connack, sizeof(connack), MSG_NOSIGNAL);
+                    connections++;
+                    break;
+                }
+                case 0x30: { // PUBLISH
+                    publishes++;
+                    publishedBytes += remaining;
+                    size_t topicLength = remaining >= 2 ? (body[0] << 8) | body[1] : 0;
+                    size_t pos = 2 + topicLength;
+                    if (type & 0x06) {
+                        // QoS 1: acknowledge with the packet id
+                        if (pos + 2 > remaining) break;
+                        const uint8_t puback[4] = { 0x40, 0x02, body[pos], body[pos + 1] };
+                        send(fd, puback, sizeof(puback), MSG_NOSIGNAL);
+                        pos += 2;
+                    }
+                    if (pos <= remaining) {
+                        std::lock_guard<std::mutex> guard(lock);
+                        payloads.insert(std::string(body.begin() + pos, body.end()));
+                    }
+                    break;
+                }
+                case 0xC0: { // PINGREQ
+                    const uint8_t pingresp[2] = { 0xD0, 0x00 };
+                    send(fd, pingresp, sizeof(pingresp), MSG_NOSIGNAL);
+                    break;
+                }
+                case 0xE0: // DISCONNECT
+                    close(fd);
+                    return;
+            }
+        }
+        close(fd);
+    }
+
+public:
+    std::atomic<uint32_t> connections;
+    std::atomic<uint32_t> publishes;
+    std::atomic<uint64_t> publishedBytes;
+
+    StandInBroker() : listenFd(-1), port(0), running(false),
+                      connections(0), publishes(0), publishedBytes(0) {}
+
+    ~StandInBroker() {
+        running = false;
+        if (listenFd >= 0) {
+            shutdown(listenFd, SHUT_RDWR);
+            close(listenFd);
+        }
+        if (worker.joinable()) worker.join();
+    }
+
+    // Listen on an ephemeral loopback port
+    bool start() {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (listenFd < 0 || bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+            listen(listenFd, 4) != 0 ||
+            getsockname(listenFd, (struct sockaddr*)&addr, &len) != 0) {
+            return false;
+        }
+        port = ntohs(addr.sin_port);
+        running = true;
+        worker = std::thread([this] {
+            while (running) {
+                int fd = accept(listenFd, nullptr, nullptr);
+                if (fd < 0) break;
+                serve(fd);
+            }
+        });
+        return true;
+    }
+
+    uint16_t getPort() const { return port; }
+
+    // Different messages received; a batch sent again after a lost PUBACK counts once
+    size_t uniquePublishes() {
+        std::lock_guard<std::mutex> guard(lock);
+        return payloads.size();
+    }
+};
+
+// Virtual time, shared by the link faults and the transport deadlines
+static unsigned long now = 0;
+
+// Wall-clock time of the start of the run (2024-01-01), for the batch "time" fields
+static const uint32_t SIM_EPOCH = 1704067200;
+
+// Wraps the socket client and injects link faults on the virtual clock. During an
+// outage, connections are refused and an open one is reset, as when WiFi drops.
+// A connection the silent period catches stays half-open for good: writes are
+// accepted and vanish, nothing the broker sends arrives, and new connections
+// time out while the silence lasts.
+class FaultyClient : public Client {
+private:
+    Client& inner;
+    unsigned long outageStart, outageEnd;
+    unsigned long silentStart, silentEnd;
+    bool halfOpen;
+
+    bool down() const { return now >= outageStart && now < outageEnd; }
+    bool silent() const { return now >= silentStart && now < silentEnd; }
+
+    bool deaf() {
+        if (silent() && inner.connected()) {
+            halfOpen = true;
+        }
+        return halfOpen;
+    }
+
+public:
+    // Connection attempts made while the broker was unreachable. On the board each
+    // one blocks the publisher task for the TCP connect timeout.
+    uint32_t failedConnects = 0;
+
+    FaultyClient(Client& _inner, unsigned long _outageStart, unsigned long _outageEnd,
+                 unsigned long _silentStart, unsigned long _silentEnd) :
+        inner(_inner), outageStart(_outageStart), outageEnd(_outageEnd),
+        silentStart(_silentStart), silentEnd(_silentEnd), halfOpen(false) {}
+
+    int connect(const char* host, uint16_t port) override {
+        halfOpen = false;
+        if (down() || silent()) {
+            failedConnects++;
+            return 0;
+        }
+        return inner.connect(host, port);
+    }
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (down()) {
+            inner.stop();
+            return 0;
+        }
+        return deaf() ? size : inner.write(buf, size);
+    }
+    int available() override {
+        if (deaf()) {
+            // Whatever the broker sent is lost on the way
+            uint8_t discard[64];
+            while (inner.available() > 0 && inner.read(discard, sizeof(discard)) > 0) {}
+            return 0;
+        }
+        return inner.available();
+    }
+    int read() override { return deaf() ? -1 : inner.read(); }
+    int read(uint8_t* buf, size_t size) override { return deaf() ? -1 : inner.read(buf, size); }
+    void stop() override { halfOpen = false; inner.stop(); }
+    uint8_t connected() override {
+        if (down()) {
+            inner.stop();
+        }
+        return inner.connected();
+    }
+};
+
+static void usage() {
+    fprintf(stderr,
+        "usage: publish_sim [--broker host:port] [--stations N] [--minutes M]\n"
+        "                   [--interval SEC] [--window SEC] [--drain PER_SEC]\n"
+        "                   [--outage START_SEC:DURATION_SEC] [--silent START_SEC:DURATION_SEC]\n"
+        "                   [--queue FILE] [--queue-slots N]\n");
+}
+
+int main(int argc, char** argv) {
+    const char* brokerArg = nullptr;
+    int stationCount = 4;
+    int minutes = 60;
+    int intervalSec = 10;
+    unsigned long outageStart = 0, outageDuration = 0;
+    unsigned long silentStart = 0, silentDuration = 0;
+    const char* queuePath = "/tmp/klimalogg_publish.q";
+    int queueSlots = 256;
+    BatchPublisher::Config config;
+    config.statsIntervalMs = 60000;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) { usage(); return 1; }
+        if (!strcmp(arg, "--broker")) brokerArg = value;
+        else if (!strcmp(arg, "--stations")) stationCount = atoi(value);
+        else if (!strcmp(arg, "--minutes")) minutes = atoi(value);
+        else if (!strcmp(arg, "--interval")) intervalSec = atoi(value);
+        else if (!strcmp(arg, "--window")) config.windowMs = atol(value) * 1000UL;
+        else if (!strcmp(arg, "--drain")) config.drainPerSecond = atoi(value);
+        else if (!strcmp(arg, "--outage")) sscanf(value, "%lu:%lu", &outageStart, &outageDuration);
+        else if (!strcmp(arg, "--silent")) sscanf(value, "%lu:%lu", &silentStart, &silentDuration);
+        else if (!strcmp(arg, "--queue")) queuePath = value;
+        else if (!strcmp(arg, "--queue-slots")) queueSlots = atoi(value);
+        else { usage(); return 1; }
+        i++;
+    }
+
+    StandInBroker standIn;
+    char host[128] = "127.0.0.1";
+    uint16_t port;
+    if (brokerArg) {
+        unsigned int parsedPort = 1883;
+        sscanf(brokerArg, "%127[^:]:%u", host, &parsedPort);
+        port = parsedPort;
+    } else {
+        if (!standIn.start()) {
+            fprintf(stderr, "cannot start stand-in broker\n");
+            return 1;
+        }
+        port = standIn.getPort();
+    }
+
+    FlashQueue queue;
+    remove(queuePath);
+    if (!queue.begin(queuePath, queueSlots, BATCH_MAX_PAYLOAD)) {
+        fprintf(stderr, "cannot open queue file %s\n", queuePath);
+        return 1;
+    }
+
+    PosixClient socket;
+    FaultyClient client(socket, outageStart * 1000UL, (outageStart + outageDuration) * 1000UL,
+                        silentStart * 1000UL, (silentStart + silentDuration) * 1000UL);
+    MqttTransport mqtt(client, host, port, "klimalogg-sim", "klimalogg/batch");
+    mqtt.setClock([]() { return now; });
+    BatchPublisher publisher(mqtt, &queue, config);
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> temperature(-20.0f, 35.0f);
+    std::uniform_int_distribution<int> humidity(20, 95);
+    std::vector<unsigned long> nextFrame(stationCount);
+    for (int s = 0; s < stationCount; s++) {
+        nextFrame[s] = (unsigned long)(rng() % (intervalSec * 1000));
+    }
+
+    printf("# time_s  msgs_per_s  avg_batch_readings  last_batch_bytes  queue_depth  queue_dropped  sent\n");
+    auto wallStart = std::chrono::steady_clock::now();
+    const unsigned long endMs = minutes * 60000UL;
+    const unsigned long stepMs = 50;
+    for (; now < endMs; now += stepMs) {
+        for (int s = 0; s < stationCount; s++) {
+            if (now < nextFrame[s]) continue;
+            nextFrame[s] += intervalSec * 1000UL;
+            KlimaLoggFrameParser::CurrentData data;
+            data.timestamp = SIM_EPOCH + now / 1000;
+            for (int x = 0; x < 9; x++) {
+                data.temperature[x] = roundf(temperature(rng) * 10) / 10;
+                data.humidity[x] = humidity(rng);
+            }
+            publisher.add(0x1000 + s, data, -60 - s, data.timestamp, now);
+        }
+        publisher.loop(now);
+
+        // Virtual time runs far ahead of the broker's answers; give a PUBACK or
+        // PINGRESP a moment of real time before the deadline can count it missing
+        for (int i = 0; i < 200 && mqtt.awaitingResponse() && !client.available(); i++) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+
+        if (now % 60000 == 0) {
+            const BatchPublisher::Stats& stats = publisher.getStats();
+            printf("%8lu  %10.3f  %18.1f  %16u  %11u  %13u  %u\n",
+                   now / 1000, stats.messagesPerSecond,
+                   stats.batches ? (double)stats.readingsBatched / stats.batches : 0.0,
+                   stats.lastBatchBytes, stats.queueDepth, stats.queueDropped,
+                   stats.messagesSent);
+        }
+    }
+
+    // Let the PUBACK of a batch still in flight arrive, so it is not counted as
+    // both delivered and queued
+    for (int i = 0; i < 200 && mqtt.awaitingResponse(); i++) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        mqtt.loop();
+        publisher.loop(now);
+    }
+
+    // Give the stand-in broker a moment to read the last packets
+    mqtt.disconnect();
+    delay(100);
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    const BatchPublisher::Stats& stats = publisher.getStats();
+    printf("# batches %u, sent %u, queued %u, retried %u, dropped %u, still queued %u\n",
+           stats.batches, stats.messagesSent, stats.messagesQueued, stats.messagesRetried,
+           stats.queueDropped, stats.queueDepth);
+    printf("# simulated %d min in %.2f s wall (%.0f msgs/s wall)\n",
+           minutes, wallSeconds, stats.messagesSent / wallSeconds);
+    printf("# connect attempts while unreachable: %u (run on the publisher task, not in loop())\n",
+           client.failedConnects);
+    printf("# sessions dropped for a missing PUBACK or PINGRESP: %u\n", mqtt.getResponseTimeouts());
+    long lost = 0;
+    if (!brokerArg) {
+        size_t unique = standIn.uniquePublishes();
+        lost = (long)stats.batches - (long)unique - stats.queueDepth - stats.queueDropped;
+        printf("# stand-in broker: %u connections, %u publishes (%zu different), %llu bytes, %ld batches lost\n",
+               standIn.connections.load(), standIn.publishes.load(), unique,
+               (unsigned long long)standIn.publishedBytes.load(), lost);
+    }
+    queue.erase();
+    return lost ? 2 : 0;
+}
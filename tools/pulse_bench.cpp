@@ -0,0 +1,377 @@
+// pulse_bench.cpp
+// Measures the CPU time per pulse train of the KlimaLogg fast path
+// (KlimaLoggPulseDecoder with its prefilter) on recorded pulse data in rtl_433's
+// .ook text format (rtl_433 -w file.ook) or on a synthetic mix of KlimaLogg frames
+// and other devices' trains, including same-rate FSK trains that pass the prefilter.
+//
+// With --rtl433 the same trains are also run through a host build of rtl_433
+// (rtl_433 -r file.ook), which is the decoder list the fast path replaces. Its
+// figure is the child's CPU time minus that of an empty file, per train. Without
+// it, the only comparison is against this decoder with the prefilter off.
+//
+// Build:
+//   g++ -std=c++17 -O2 -Itools/host -Isrc tools/pulse_bench.cpp -o pulse_bench
+//
+// Examples:
+//   ./pulse_bench --synth 2000 --klimalogg 5 --write mix.ook
+//   ./pulse_bench mix.ook --rtl433 /usr/local/bin/rtl_433
+//   ./pulse_bench g001_868.3M_250k.ook --rtl433 rtl_433
+
+#include <Arduino.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "FrameParser.h"
+#include "KlimaLoggPulseDecoder.h"
+
+DeferredLog deferredLog;
+
+struct PulseTrain {
+    std::vector<uint16_t> pulse;
+    std::vector<uint16_t> gap;
+    bool fsk = false;       // rtl_433 runs FSK and OOK trains through different decoders
+};
+
+static unsigned long framesSeen = 0, framesValid = 0;
+
+static FramePool framePool;
+
+static void onFrame(FrameHandle frame) {
+    framesSeen++;
+    if (frame.length() >= KlimaLoggFrameParser::CurrentWeatherSchema::LENGTH &&
+        KlimaLoggFrameParser::hasValidReadings(
+            KlimaLoggFrameParser::parseCurrentWeatherFrame(frame.data(), frame.length()))) {
+        framesValid++;
+    }
+}
+
+// Reads ";pulse data" blocks of "pulse gap" lines, each ended by ";end"
+static bool readOok(const char* path, std::vector<PulseTrain>& trains) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[128];
+    PulseTrain train;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == ';') {
+            if (!strncmp(line, ";end", 4) && !train.pulse.empty()) {
+                trains.push_back(train);
+                train = PulseTrain();
+            } else if (!strncmp(line, ";fsk", 4)) {
+                train.fsk = true;
+            }
+            continue;
+        }
+        unsigned long p, g;
+        if (sscanf(line, "%lu %lu", &p, &g) == 2) {
+            train.pulse.push_back(p > 0xFFFF ? 0xFFFF : p);
+            train.gap.push_back(g > 0xFFFF ? 0xFFFF : g);
+        }
+    }
+    if (!train.pulse.empty()) trains.push_back(train);
+    fclose(f);
+    return true;
+}
+
+static bool writeOok(const char* path, const std::vector<PulseTrain>& trains) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    for (const PulseTrain& t : trains) {
+        fprintf(f, ";pulse data\n;version 1\n;timescale 1us\n;%s %zu pulses\n",
+                t.fsk ? "fsk" : "ook", t.pulse.size());
+        for (size_t i = 0; i < t.pulse.size(); i++) {
+            fprintf(f, "%u %u\n", t.pulse[i], t.gap[i]);
+        }
+        fprintf(f, ";end\n");
+    }
+    fclose(f);
+    return true;
+}
+
+// Line coding as the AX5051 transmits it: HDLC bit stuffing, scrambling,
+// differential encoding and inversion; the inverse of KlimaLoggPulseDecoder
+class LineEncoder {
+private:
+    const KlimaLoggPulseDecoder::Config& config;
+    uint32_t history = 0;
+    uint8_t level = 0;
+    std::vector<uint8_t>& levels;
+
+    void channel(uint8_t bit) {
+        if (config.scrambled) {
+            bit ^= ((history >> 11) & 1) ^ ((history >> 16) & 1);
+            history = (history << 1) | bit;
+        }
+        if (config.differential) {
+            level = bit ? level : !level;
+            bit = level;
+        }
+        levels.push_back(bit ^ (config.invert ? 1 : 0));
+    }
+
+public:
+    LineEncoder(const KlimaLoggPulseDecoder::Config& _config, std::vector<uint8_t>& _levels) :
+        config(_config), levels(_levels) {}
+
+    void flag() {
+        for (int i = 0; i < 8; i++) channel((KlimaLoggPulseDecoder::HDLC_FLAG >> i) & 1);
+    }
+
+    void data(const uint8_t* bytes, size_t length) {
+        int ones = 0;
+        for (size_t n = 0; n < length; n++) {
+            for (int i = 0; i < 8; i++) {
+                uint8_t bit = (bytes[n] >> i) & 1;
+                channel(bit);
+                ones = bit ? ones + 1 : 0;
+                if (ones == 5) {
+                    channel(0);
+                    ones = 0;
+                }
+            }
+        }
+    }
+};
+
+// Turns channel levels into mark/space durations with timing jitter
+static PulseTrain toTrain(const std::vector<uint8_t>& levels, float bitUs, std::mt19937& rng) {
+    std::normal_distribution<float> jitter(0.0f, bitUs * 0.05f);
+    PulseTrain t;
+    size_t i = 0;
+    while (i < levels.size() && levels[i] == 0) i++; // Trains start with a mark
+    while (i < levels.size()) {
+        size_t run = 0;
+        uint8_t level = levels[i];
+        while (i < levels.size() && levels[i] == level) { run++; i++; }
+        uint16_t width = (uint16_t)std::max(1.0f, run * bitUs + jitter(rng));
+        if (level) {
+            t.pulse.push_back(width);
+        } else {
+            t.gap.push_back(width);
+        }
+    }
+    if (t.gap.size() < t.pulse.size()) t.gap.push_back(10000);
+    return t;
+}
+
+static PulseTrain klimaLoggTrain(const KlimaLoggPulseDecoder::Config& config, std::mt19937& rng) {
+    KlimaLoggFrameParser::CurrentData data;
+    std::uniform_int_distribution<int> temp(-200, 350), hum(20, 95);
+    data.timestamp = 1700000000;
+    data.signalQuality = 90;
+    for (int s = 0; s < 9; s++) {
+        if (s < 5) {
+            data.temperature[s] = temp(rng) / 10.0f;
+            data.humidity[s] = hum(rng);
+        }
+    }
+    uint8_t frame[KlimaLoggFrameParser::CurrentWeatherSchema::FULL_LENGTH];
+    memset(frame, 0, sizeof(frame));
+    KlimaLoggFrameParser::encodeCurrentWeatherFrame(data, frame, sizeof(frame));
+
+    std::vector<uint8_t> levels;
+    LineEncoder encoder(config, levels);
+    for (int i = 0; i < 8; i++) encoder.flag();   // Preamble, also syncs the descrambler
+    encoder.data(frame, sizeof(frame));
+    for (int i = 0; i < 3; i++) encoder.flag();
+    PulseTrain t = toTrain(levels, config.bitUs, rng);
+    t.fsk = true;
+    return t;
+}
+
+// Other FSK devices at the same 17.24 kbit/s: La Crosse IT+ style sensors (short
+// NRZ frames behind a 0xAA preamble and 0x2DD4 sync), and long unframed PCM that
+// gets past the prefilter and costs a full decode without producing a frame
+static PulseTrain sameRateTrain(const KlimaLoggPulseDecoder::Config& config, std::mt19937& rng) {
+    std::vector<uint8_t> levels;
+    std::vector<uint8_t> bytes = { 0xAA, 0xAA, 0xAA, 0x2D, 0xD4 };
+    bool longPcm = rng() & 1;
+    size_t payload = longPcm ? std::uniform_int_distribution<int>(150, 400)(rng) : 5;
+    for (size_t i = 0; i < payload; i++) bytes.push_back(rng() & 0xFF);
+    for (uint8_t b : bytes) {
+        for (int i = 7; i >= 0; i--) levels.push_back((b >> i) & 1);
+    }
+    PulseTrain t = toTrain(levels, config.bitUs, rng);
+    t.fsk = true;
+    return t;
+}
+
+// Other devices: OOK-style trains of a few hundred microsecond pulses, and noise
+static PulseTrain otherTrain(std::mt19937& rng) {
+    std::uniform_int_distribution<int> kind(0, 2), shortCount(24, 160), longCount(200, 900);
+    std::uniform_int_distribution<int> ookShort(180, 520), noise(20, 3000);
+    PulseTrain t;
+    int k = kind(rng);
+    int n = k == 2 ? longCount(rng) : shortCount(rng);
+    for (int i = 0; i < n; i++) {
+        if (k == 2) {
+            t.pulse.push_back(noise(rng));
+            t.gap.push_back(noise(rng));
+        } else {
+            int s = ookShort(rng);
+            bool one = rng() & 1;
+            t.pulse.push_back(one ? s * 2 : s);
+            t.gap.push_back(one ? s : s * 2);
+        }
+    }
+    return t;
+}
+
+static double nsPerTrain(KlimaLoggPulseDecoder& decoder, const std::vector<PulseTrain>& trains,
+                         bool prefilter, int rounds) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (const PulseTrain& t : trains) {
+            if (prefilter) {
+                decoder.process(t.pulse.data(), t.gap.data(), t.pulse.size(), -50);
+            } else {
+                decoder.decode(t.pulse.data(), t.gap.data(), t.pulse.size(), -50);
+            }
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / ((double)rounds * trains.size());
+}
+
+// User plus system CPU seconds of the fastest of `runs` runs of "rtl_433 -r path",
+// with its output discarded, or -1 if it could not be run
+static double rtl433CpuSeconds(const char* rtl433, const char* path, int runs) {
+    double best = -1;
+    for (int r = 0; r < runs; r++) {
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+        posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+        char* args[] = { (char*)rtl433, (char*)"-r", (char*)path, nullptr };
+        pid_t pid;
+        int err = posix_spawnp(&pid, rtl433, &actions, nullptr, args, environ);
+        posix_spawn_file_actions_destroy(&actions);
+        if (err != 0) return -1;
+
+        int status;
+        struct rusage usage;
+        if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) == 127) {
+            return -1;
+        }
+        double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+                     usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+        if (best < 0 || cpu < best) best = cpu;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    const char* input = nullptr;
+    const char* output = nullptr;
+    int synth = 0, rounds = 0;
+    double klimaloggPercent = 5, sameRatePercent = 20;
+    const char* rtl433 = nullptr;
+    int rtl433Runs = 3;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--synth" && more) synth = atoi(argv[++i]);
+        else if (a == "--klimalogg" && more) klimaloggPercent = atof(argv[++i]);
+        else if (a == "--same-rate" && more) sameRatePercent = atof(argv[++i]);
+        else if (a == "--write" && more) output = argv[++i];
+        else if (a == "--rtl433" && more) rtl433 = argv[++i];
+        else if (a == "--rtl433-runs" && more) rtl433Runs = std::max(1, atoi(argv[++i]));
+        else if (a == "--rounds" && more) rounds = atoi(argv[++i]);
+        else if (a == "--seed" && more) seed = atoi(argv[++i]);
+        else if (a[0] != '-' && !input) input = argv[i];
+        else {
+            fprintf(stderr, "usage: pulse_bench [file.ook] [--synth N] [--klimalogg PERCENT] "
+                            "[--same-rate PERCENT]\n"
+                            "                   [--write file.ook] [--rounds N] [--seed N] "
+                            "[--rtl433 PATH] [--rtl433-runs N]\n");
+            return 1;
+        }
+    }
+    if (!input && !synth) synth = 2000;
+
+    KlimaLoggPulseDecoder::Config config;
+    std::vector<PulseTrain> trains;
+    if (input && !readOok(input, trains)) {
+        fprintf(stderr, "cannot read %s\n", input);
+        return 1;
+    }
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> pick(0, 100);
+    for (int i = 0; i < synth; i++) {
+        double p = pick(rng);
+        trains.push_back(p < klimaloggPercent ? klimaLoggTrain(config, rng) :
+                         p < klimaloggPercent + sameRatePercent ? sameRateTrain(config, rng) :
+                         otherTrain(rng));
+    }
+    if (trains.empty()) {
+        fprintf(stderr, "no pulse trains\n");
+        return 1;
+    }
+    if (output && !writeOok(output, trains)) {
+        fprintf(stderr, "cannot write %s\n", output);
+        return 1;
+    }
+
+    size_t pulses = 0;
+    for (const PulseTrain& t : trains) pulses += t.pulse.size();
+    if (!rounds) rounds = std::max<size_t>(1, 2000000 / pulses);
+
+    // One pass each to count frames, then timed passes with the handler off
+    KlimaLoggPulseDecoder full(framePool, onFrame, config), fast(framePool, onFrame, config);
+    nsPerTrain(full, trains, false, 1);
+    unsigned long fullFrames = framesSeen, fullValid = framesValid;
+    framesSeen = framesValid = 0;
+    nsPerTrain(fast, trains, true, 1);
+    unsigned long fastFrames = framesSeen, fastValid = framesValid;
+    const KlimaLoggPulseDecoder::Stats stats = fast.getStats();
+
+    KlimaLoggPulseDecoder fullTimed(framePool, nullptr, config), fastTimed(framePool, nullptr, config);
+    double fullNs = nsPerTrain(fullTimed, trains, false, rounds);
+    double fastNs = nsPerTrain(fastTimed, trains, true, rounds);
+
+    printf("trains:           %zu (%zu pulses, %d rounds)\n", trains.size(), pulses, rounds);
+    printf("prefilter:        %lu rejected, %lu decoded\n",
+           (unsigned long)stats.rejected, (unsigned long)stats.decoded);
+    printf("frames:           full %lu (%lu valid), fast path %lu (%lu valid)\n",
+           fullFrames, fullValid, fastFrames, fastValid);
+    printf("full decode:      %.0f ns/train\n", fullNs);
+    printf("fast path:        %.0f ns/train (%.1fx)\n", fastNs, fullNs / fastNs);
+
+    if (rtl433) {
+        // rtl_433 reads the recording itself; synthetic trains go through a file first
+        std::string ookPath = output ? output : input && !synth ? input : "";
+        char scratch[] = "/tmp/pulse_bench_XXXXXX.ook";
+        if (ookPath.empty()) {
+            int fd = mkstemps(scratch, 4);
+            if (fd < 0 || (close(fd), !writeOok(scratch, trains))) {
+                fprintf(stderr, "cannot write a scratch .ook file\n");
+                return 1;
+            }
+            ookPath = scratch;
+        }
+        char empty[] = "/tmp/pulse_bench_empty_XXXXXX.ook";
+        int fd = mkstemps(empty, 4);
+        if (fd < 0 || (close(fd), !writeOok(empty, {}))) {
+            fprintf(stderr, "cannot write a scratch .ook file\n");
+            return 1;
+        }
+        double startup = rtl433CpuSeconds(rtl433, empty, rtl433Runs);
+        double total = rtl433CpuSeconds(rtl433, ookPath.c_str(), rtl433Runs);
+        remove(empty);
+        if (ookPath == scratch) remove(scratch);
+        if (startup < 0 || total < 0) {
+            fprintf(stderr, "cannot run %s\n", rtl433);
+            return 1;
+        }
+        double rtlNs = (total - startup) * 1e9 / trains.size();
+        printf("rtl_433 -r:       %.0f ns/train (%.3f s CPU, %.3f s of it startup, best of %d)\n",
+               rtlNs, total, startup, rtl433Runs);
+        printf("fast path:        %.1fx faster than rtl_433\n", rtlNs / fastNs);
+    }
+    return fullValid == fastValid ? 0 : 2;
+}
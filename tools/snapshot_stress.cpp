@@ -0,0 +1,127 @@
+// snapshot_stress.cpp
+// Threaded stress test of SnapshotPublisher: one writer publishes values whose
+// fields must all agree, several readers copy them out as fast as they can and
+// check every copy for tearing and for generations going backwards. Reports
+// per-reader throughput and exits non-zero if any inconsistent value was seen.
+//
+// Build:
+//   g++ -std=c++17 -O2 -pthread -Itools/host -Isrc tools/snapshot_stress.cpp -o snapshot_stress
+//
+// Examples:
+//   ./snapshot_stress --readers 3 --seconds 5
+//   ./snapshot_stress --readers 8 --seconds 10 --rate 20
+
+#include <Arduino.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "SnapshotPublisher.h"
+
+// About the size of KlimaLoggSnapshot; every word carries the same sequence number
+struct StressValue {
+    uint32_t sequence;
+    uint32_t words[140];
+    uint32_t check;
+};
+
+static bool consistent(const StressValue& v) {
+    for (size_t i = 0; i < sizeof(v.words) / sizeof(v.words[0]); i++) {
+        if (v.words[i] != v.sequence) {
+            return false;
+        }
+    }
+    return v.check == ~v.sequence;
+}
+
+struct ReaderResult {
+    uint64_t reads = 0;
+    uint64_t busy = 0;          // read() gave up because the writer kept updating
+    uint64_t torn = 0;
+    uint64_t backwards = 0;
+};
+
+int main(int argc, char** argv) {
+    int readers = 3;
+    double seconds = 5;
+    double rate = 0;            // Writer updates per second, 0 = as fast as possible
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--readers" && more) readers = atoi(argv[++i]);
+        else if (a == "--seconds" && more) seconds = atof(argv[++i]);
+        else if (a == "--rate" && more) rate = atof(argv[++i]);
+        else {
+            fprintf(stderr, "usage: snapshot_stress [--readers N] [--seconds S] [--rate PER_SEC]\n");
+            return 1;
+        }
+    }
+    if (readers < 1) {
+        readers = 1;
+    }
+
+    static SnapshotPublisher<StressValue> publisher;
+    std::atomic<bool> running(true);
+    std::atomic<uint64_t> published(0);
+    std::vector<ReaderResult> results(readers);
+    std::vector<std::thread> threads;
+
+    threads.emplace_back([&]() {
+        StressValue v;
+        auto interval = std::chrono::duration<double>(rate > 0 ? 1.0 / rate : 0);
+        for (uint32_t n = 1; running; n++) {
+            v.sequence = n;
+            for (uint32_t& w : v.words) w = n;
+            v.check = ~n;
+            publisher.publish(v);
+            published++;
+            if (rate > 0) {
+                std::this_thread::sleep_for(interval);
+            }
+        }
+    });
+
+    for (int r = 0; r < readers; r++) {
+        threads.emplace_back([&, r]() {
+            ReaderResult& result = results[r];
+            StressValue v;
+            uint32_t lastGeneration = 0, lastSequence = 0;
+            while (running) {
+                uint32_t generation;
+                if (!publisher.read(v, &generation)) {
+                    result.busy++;
+                    continue;
+                }
+                result.reads++;
+                if (!consistent(v)) {
+                    result.torn++;
+                }
+                if (generation < lastGeneration || v.sequence < lastSequence) {
+                    result.backwards++;
+                }
+                lastGeneration = generation;
+                lastSequence = v.sequence;
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    running = false;
+    for (std::thread& t : threads) t.join();
+
+    ReaderResult total;
+    printf("writer:   %llu values published (%.0f/s)\n",
+           (unsigned long long)published.load(), published.load() / seconds);
+    for (int r = 0; r < readers; r++) {
+        const ReaderResult& result = results[r];
+        printf("reader %d: %.0f reads/s, %llu busy, %llu torn, %llu out of order\n", r,
+               result.reads / seconds, (unsigned long long)result.busy,
+               (unsigned long long)result.torn, (unsigned long long)result.backwards);
+        total.reads += result.reads;
+        total.torn += result.torn;
+        total.backwards += result.backwards;
+    }
+    printf("total:    %.0f reads/s, %llu torn, %llu out of order\n", total.reads / seconds,
+           (unsigned long long)total.torn, (unsigned long long)total.backwards);
+    return total.torn || total.backwards ? 2 : 0;
+}